@@ -7,6 +7,7 @@ import base64
 import argparse
 import functools
 import traceback
+import torch
 import numpy as np
 from pathlib import Path
 from yaspin import yaspin
@@ -39,6 +40,70 @@ def spinner_run(text='Processing...', hide=False):
         return wrapper
     return decorator
 
+class StatefulEncoder(torch.nn.Module):
+    # SANM encoder + cif predictor over the new frames of a chunk ([center | right]),
+    # the left context keys/values of every layer come from `in_enc_cache_*`.
+    def __init__(self, model, chunk_size):
+        super().__init__()
+        self.layers = torch.nn.ModuleList([model.encoder.encoders0[0]] + list(model.encoder.encoders))
+        self.after_norm = model.encoder.after_norm
+        self.predictor = model.predictor
+        self.left = chunk_size[0]
+        self.center = chunk_size[1]
+
+    def attention(self, attn, x, cache, mask):
+        # cache: [1, left, 2 * d], keys and values of the left context
+        dims = attn.h * attn.d_k
+        q, k, v = torch.split(attn.linear_q_k_v(x), dims, dim=-1)
+        k_cache, v_cache = torch.split(cache, dims, dim=-1)
+        k = torch.cat([k_cache, k], 1)
+        v = torch.cat([v_cache, v], 1) * mask.unsqueeze(-1)
+        # the last `left` frames of center are the left context of next chunk
+        new_cache = torch.cat([k, v], -1)[:, self.center:self.center + self.left, :]
+        # fsmn memory over [left | center | right], keep rows of the new frames
+        fsmn = attn.fsmn_block(attn.pad_fn(v.transpose(1, 2))).transpose(1, 2) + v
+        fsmn = fsmn[:, self.left:, :]
+        b, t, _ = x.size()
+        q_h = q.reshape(b, t, attn.h, attn.d_k).transpose(1, 2) * attn.d_k ** (-0.5)
+        k_h = k.reshape(b, -1, attn.h, attn.d_k).transpose(1, 2)
+        v_h = v.reshape(b, -1, attn.h, attn.d_k).transpose(1, 2)
+        scores = torch.matmul(q_h, k_h.transpose(-2, -1))
+        scores = torch.softmax(scores.masked_fill(~mask[:, None, None, :], -10000.0), dim=-1)
+        att = torch.matmul(scores, v_h).transpose(1, 2).reshape(b, t, dims)
+        return attn.linear_out(att) + fsmn, new_cache
+
+    def layer(self, layer, x, cache, mask):
+        residual = x
+        if layer.normalize_before:
+            x = layer.norm1(x)
+        att, new_cache = self.attention(layer.self_attn, x, cache, mask)
+        x = residual + att if layer.in_size == layer.size else att
+        if not layer.normalize_before:
+            x = layer.norm1(x)
+        residual = x
+        if layer.normalize_before:
+            x = layer.norm2(x)
+        x = residual + layer.feed_forward(x)
+        if not layer.normalize_before:
+            x = layer.norm2(x)
+        return x, new_cache
+
+    def forward(self, speech, enc_len, *caches):
+        x = speech
+        # padding mask of [left | new frames], the left context is always valid
+        frames = torch.arange(speech.size(1)).unsqueeze(0) < enc_len.unsqueeze(-1)
+        mask = torch.cat([torch.ones(1, self.left, dtype=torch.bool), frames], 1)
+        out_caches = []
+        for layer, cache in zip(self.layers, caches):
+            x, new_cache = self.layer(layer, x, cache, mask)
+            out_caches.append(new_cache)
+        enc = self.after_norm(x)
+        predictor = self.predictor
+        output = torch.relu(predictor.cif_conv1d(predictor.pad(enc.transpose(1, 2)))).transpose(1, 2)
+        alphas = torch.sigmoid(predictor.cif_output(output))
+        alphas = torch.relu(alphas * predictor.smooth_factor - predictor.noise_threshold).squeeze(-1)
+        return (alphas, enc, enc_len + 0, *out_caches)
+
 class Paraformer:
 
     def __init__(self, args):
@@ -50,8 +115,31 @@ class Paraformer:
             self.mnnconvert = args.mnnconvert
         else:
             self.mnnconvert = None
+        self.decoder_ids_only = args.decoder_ids_only
+        self.stateful_encoder = args.stateful_encoder
+        self.static_shape = args.static_shape
+        self.max_tokens = args.max_tokens
+        self.quant_bit = args.quant_bit
+        self.quant_block = args.quant_block
+        self.chunk_size = [5, 10, 5]
 
     def convert(self, onnx_path, mnn_path):
+        self.run_convert(onnx_path, mnn_path)
+        if self.quant_bit:
+            # weight quantized variant, selected by `weight_quant` in config.json
+            quant_args = [
+                '--transformerFuse',
+                '--weightQuantBits',
+                str(self.quant_bit),
+                '--weightQuantAsymmetric',
+                '--weightQuantBlock',
+                str(self.quant_block),
+            ]
+            quant_path = str(mnn_path).replace('.mnn', f'_int{self.quant_bit}.mnn')
+            self.run_convert(onnx_path, quant_path, quant_args)
+            print(f'{GREEN}[SAVED]{RESET} {quant_path}')
+
+    def run_convert(self, onnx_path, mnn_path, extra_args=[]):
         convert_args = [
             '',
             '-f',
@@ -60,8 +148,7 @@ class Paraformer:
             str(onnx_path),
             '--MNNModel',
             str(mnn_path),
-            # '--transformerFuse',
-        ]
+        ] + extra_args
         sfd = os.dup(1)
         log_fp = open('./.export.log', "a")
         log_fd = log_fp.fileno()
@@ -89,6 +176,29 @@ class Paraformer:
         onnx_path = model.export(quantize=False)
         return onnx_path
 
+    @spinner_run("strip decoder logits")
+    def strip_decoder_logits(self, decoder_model_file):
+        # replace `logits` [1, N, vocab] output with top-1 `token_prob` [1, N], full logits
+        # never leave the model. the runtime reads `sample_ids`, `token_prob` is for callers
+        # that want a per-token confidence
+        import onnx
+        from onnx import helper, TensorProto
+        model = onnx.load(decoder_model_file)
+        graph = model.graph
+        logits = [o for o in graph.output if o.name == 'logits']
+        if not logits:
+            return decoder_model_file
+        graph.output.remove(logits[0])
+        # opset 14: ReduceMax takes its axes as an attribute
+        graph.node.extend([
+            helper.make_node('Softmax', ['logits'], ['logits_prob'], axis=-1),
+            helper.make_node('ReduceMax', ['logits_prob'], ['token_prob'], axes=[-1], keepdims=0)
+        ])
+        graph.output.insert(1, helper.make_tensor_value_info('token_prob', TensorProto.FLOAT, None))
+        ids_model_file = decoder_model_file.replace('.onnx', '_ids.onnx')
+        onnx.save(model, ids_model_file)
+        return ids_model_file
+
     @spinner_run("convert onnx to mnn")
     def convert_to_mnn(self, encoder_model_file, decoder_model_file):
         encoder_path = f'{self.dst_path}/encoder.mnn'
@@ -101,11 +211,99 @@ class Paraformer:
         print(f'{GREEN}[SAVED]{RESET} {decoder_path}')
         return self.dst_path
 
+    @spinner_run("export stateful encoder")
+    def export_stateful_encoder(self, onnx_path):
+        model = AutoModel(model=self.model_path, disable_update=True).model
+        model.eval()
+        encoder = StatefulEncoder(model, self.chunk_size)
+        layer_num = len(encoder.layers)
+        hidden_size = model.encoder.output_size()
+        frames = self.chunk_size[1] + self.chunk_size[2]
+        speech = torch.randn(1, frames, encoder.layers[0].in_size)
+        enc_len = torch.tensor([frames], dtype=torch.int32)
+        caches = [torch.zeros(1, self.chunk_size[0], 2 * hidden_size) for _ in range(layer_num)]
+        input_names = ['speech', 'enc_len'] + [f'in_enc_cache_{i}' for i in range(layer_num)]
+        output_names = ['alphas', 'enc', 'enc_len_out'] + [f'out_enc_cache_{i}' for i in range(layer_num)]
+        onnx_model_file = os.path.join(onnx_path, 'encoder_stateful.onnx')
+        torch.onnx.export(encoder, (speech, enc_len, *caches), onnx_model_file,
+                          input_names=input_names, output_names=output_names,
+                          dynamic_axes={'speech': {1: 'frames'}, 'alphas': {1: 'frames'}, 'enc': {1: 'frames'}},
+                          opset_version=14)
+        mnn_path = f'{self.dst_path}/encoder_stateful.mnn'
+        self.convert(onnx_model_file, mnn_path)
+        print(f'{GREEN}[SAVED]{RESET} {mnn_path}')
+        return onnx_model_file
+
+    def make_static(self, onnx_model_file, shapes):
+        import onnx
+        model = onnx.load(onnx_model_file)
+        for tensor in model.graph.input:
+            dims = tensor.type.tensor_type.shape.dim
+            values = shapes.get(tensor.name, [1] * len(dims))
+            for dim, value in zip(dims, values):
+                if tensor.name in shapes or dim.HasField('dim_param'):
+                    dim.dim_value = value
+        return model
+
+    def gather_decoder_caches(self, graph, lorder):
+        # out_cache_i is the tail `lorder` frames of [in_cache | acoustic_embeds]; with padded
+        # acoustic_embeds it must end at acoustic_embeds_len, gather keeps the output shape static
+        from onnx import helper, numpy_helper, TensorProto
+        graph.node.extend([
+            helper.make_node('Cast', ['acoustic_embeds_len'], ['acoustic_embeds_len_i64'], to=TensorProto.INT64),
+            helper.make_node('Add', ['acoustic_embeds_len_i64', 'cache_range'], ['cache_index'])
+        ])
+        graph.initializer.append(numpy_helper.from_array(np.arange(lorder, dtype=np.int64), 'cache_range'))
+        initializers = {t.name: numpy_helper.to_array(t) for t in graph.initializer}
+        cache_names = {o.name for o in graph.output if o.name.startswith('out_cache_')}
+        for node in graph.node:
+            if node.op_type != 'Slice' or node.output[0] not in cache_names:
+                continue
+            axis = int(initializers[node.input[3]][0]) if len(node.input) > 3 and node.input[3] in initializers else 2
+            data = node.input[0]
+            del node.input[:]
+            node.input.extend([data, 'cache_index'])
+            node.op_type = 'Gather'
+            node.attribute.append(helper.make_attribute('axis', axis))
+            cache_names.remove(node.output[0])
+        if cache_names:
+            raise RuntimeError(f'decoder caches are not produced by Slice: {sorted(cache_names)}')
+
+    @spinner_run("export static shape model")
+    def export_static(self, encoder_model_file, decoder_model_file):
+        import onnx
+        model_config = self.load_model_config()
+        hidden_size = model_config["encoder_conf"]["output_size"]
+        feats_dims = model_config["frontend_conf"]["n_mels"] * model_config["frontend_conf"]["lfr_m"]
+        lorder = model_config["decoder_conf"]["kernel_size"] - 1
+        window = sum(self.chunk_size)
+        # the stateful encoder only sees [center | right] frames
+        speech_frames = window - self.chunk_size[0] if self.stateful_encoder else window
+        encoder = self.make_static(encoder_model_file, {'speech': [1, speech_frames, feats_dims], 'enc_len': [1]})
+        decoder = self.make_static(decoder_model_file, {
+            'enc': [1, window, hidden_size], 'enc_len': [1],
+            'acoustic_embeds': [1, self.max_tokens, hidden_size], 'acoustic_embeds_len': [1]
+        })
+        self.gather_decoder_caches(decoder.graph, lorder)
+        for model, onnx_model_file in [(encoder, encoder_model_file), (decoder, decoder_model_file)]:
+            name = Path(onnx_model_file).stem.replace('model', 'encoder').replace('_ids', '')
+            static_onnx_file = os.path.join(os.path.dirname(onnx_model_file), f'{name}_static.onnx')
+            onnx.save(model, static_onnx_file)
+            mnn_path = f'{self.dst_path}/{name}_static.mnn'
+            self.convert(static_onnx_file, mnn_path)
+            print(f'{GREEN}[SAVED]{RESET} {mnn_path}')
+
     def export_model(self):
         onnx_path = self.export_onnx()
         encoder_model_file = os.path.join(onnx_path, "model.onnx")
         decoder_model_file = os.path.join(onnx_path, "decoder.onnx")
+        if self.decoder_ids_only:
+            decoder_model_file = self.strip_decoder_logits(decoder_model_file)
         self.convert_to_mnn(encoder_model_file, decoder_model_file)
+        if self.stateful_encoder:
+            encoder_model_file = self.export_stateful_encoder(onnx_path)
+        if self.static_shape:
+            self.export_static(encoder_model_file, decoder_model_file)
 
     def load_cmvn(self):
         cmvn_file = os.path.join(self.model_path, "am.mvn")
@@ -133,38 +331,44 @@ class Paraformer:
         vars = np.array(vars_list).astype(np.float32).tolist()
         return means, vars
 
-    @spinner_run("export config")
-    def export_config(self):
-        asr_config = {}
+    def load_model_config(self):
         # load config from `config.yaml`
         config_file = os.path.join(self.model_path, "config.yaml")
         if not Path(config_file).exists():
             raise FileExistsError(f"The {config_file} does not exist.")
         with open(str(config_file), "rb") as f:
-            data = yaml.load(f, Loader=yaml.Loader)
-            # model
-            asr_config['encoder_output_size'] = data["encoder_conf"]["output_size"]
-            asr_config['fsmn_layer'] = data["decoder_conf"]["num_blocks"]
-            asr_config['fsmn_lorder'] = data["decoder_conf"]["kernel_size"] - 1
-            asr_config['fsmn_dims'] = data["encoder_conf"]["output_size"]
-            asr_config['feats_dims'] = data["frontend_conf"]["n_mels"] * data["frontend_conf"]["lfr_m"]
-            # predictor
-            asr_config['cif_threshold'] = data['predictor_conf']['threshold']
-            asr_config['tail_threshold'] = data['predictor_conf']['tail_threshold']
-            # frontend
-            asr_config['samp_freq'] = data["frontend_conf"]["fs"]
-            asr_config['window_type'] = data["frontend_conf"]["window"]
-            asr_config['frame_shift_ms'] = data["frontend_conf"]["frame_shift"]
-            asr_config['frame_length_ms'] = data["frontend_conf"]["frame_length"]
-            asr_config['num_bins'] = data["frontend_conf"]["n_mels"]
-            # asr_config['dither'] = data["frontend_conf"]["dither"]
-            asr_config['lfr_m'] = data["frontend_conf"]["lfr_m"]
-            asr_config['lfr_n'] = data["frontend_conf"]["lfr_n"]
+            return yaml.load(f, Loader=yaml.Loader)
+
+    @spinner_run("export config")
+    def export_config(self):
+        asr_config = {}
+        data = self.load_model_config()
+        # model
+        asr_config['encoder_output_size'] = data["encoder_conf"]["output_size"]
+        asr_config['encoder_layers'] = data["encoder_conf"]["num_blocks"]
+        asr_config['fsmn_layer'] = data["decoder_conf"]["num_blocks"]
+        asr_config['fsmn_lorder'] = data["decoder_conf"]["kernel_size"] - 1
+        asr_config['fsmn_dims'] = data["encoder_conf"]["output_size"]
+        asr_config['feats_dims'] = data["frontend_conf"]["n_mels"] * data["frontend_conf"]["lfr_m"]
+        # predictor
+        asr_config['cif_threshold'] = data['predictor_conf']['threshold']
+        asr_config['tail_threshold'] = data['predictor_conf']['tail_threshold']
+        # frontend
+        asr_config['samp_freq'] = data["frontend_conf"]["fs"]
+        asr_config['window_type'] = data["frontend_conf"]["window"]
+        asr_config['frame_shift_ms'] = data["frontend_conf"]["frame_shift"]
+        asr_config['frame_length_ms'] = data["frontend_conf"]["frame_length"]
+        asr_config['num_bins'] = data["frontend_conf"]["n_mels"]
+        # asr_config['dither'] = data["frontend_conf"]["dither"]
+        asr_config['lfr_m'] = data["frontend_conf"]["lfr_m"]
+        asr_config['lfr_n'] = data["frontend_conf"]["lfr_n"]
 
         mean, var = self.load_cmvn()
         asr_config['mean'] = mean
         asr_config['var'] = var
-        asr_config['chunk_size'] = [5, 10, 5]
+        asr_config['chunk_size'] = self.chunk_size
+        if self.static_shape:
+            asr_config['max_tokens'] = self.max_tokens
 
         asr_config_path = f'{self.dst_path}/asr_config.json'
         config_path = f'{self.dst_path}/config.json'
@@ -181,6 +385,16 @@ class Paraformer:
                 "precision": "low",
                 "memory": "low"
             }
+            encoder_name = "encoder_stateful" if self.stateful_encoder else "encoder"
+            if self.stateful_encoder:
+                config["encoder_model"] = f"{encoder_name}.mnn"
+                config["encoder_stateful"] = True
+            if self.static_shape:
+                config["encoder_model"] = f"{encoder_name}_static.mnn"
+                config["decoder_model"] = f"decoder_static.mnn"
+                config["static_shape"] = True
+            if self.quant_bit:
+                config["weight_quant"] = f"int{self.quant_bit}"
             json.dump(config, f, ensure_ascii=False, indent=4)
 
         print(f'{GREEN}[SAVED]{RESET} {config_path}')
@@ -226,6 +440,12 @@ if __name__ == '__main__':
     parser.add_argument('--path', type=str, required=True, help='path of model.')
     parser.add_argument('--dst_path', type=str, default='./model', help='export onnx/mnn model to path, defaut is `./model`.')
     parser.add_argument('--mnnconvert', type=str, default='../../../build/MNNConvert', help='local mnnconvert path, if invalid, using pymnn.')
+    parser.add_argument('--decoder_ids_only', action='store_true', help='export decoder with `sample_ids` and top-1 `token_prob` outputs only, without `logits`.')
+    parser.add_argument('--stateful_encoder', action='store_true', help='also export a streaming encoder with per-layer left context caches.')
+    parser.add_argument('--static_shape', action='store_true', help='also export fixed shape encoder/decoder for `chunk_size` streaming.')
+    parser.add_argument('--max_tokens', type=int, default=10, help='acoustic_embeds length of the static shape decoder, defaut is 10.')
+    parser.add_argument('--quant_bit', type=int, default=0, choices=[0, 4, 8], help='also export weight quantized models with `--transformerFuse`, 0 means float only, defaut is 0.')
+    parser.add_argument('--quant_block', type=int, default=64, help='block size of weight quantization, 0 means channel-wise, defaut is 64.')
     args = parser.parse_args()
     paraformer = Paraformer(args)
     paraformer.export()
\ No newline at end of file
@@ -7,18 +7,91 @@
 
 #include "asr.hpp"
 #include <audio/audio.hpp>
+#include <MNN/expr/ExecutorScope.hpp>
 #include <cmath>
+#include <algorithm>
 #include <complex>
 #include <random>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
 #include "utils/utils.h"
 #include "utils/timer.h"
+#include "utils/pcm_ring.h"
+#include "utils/mapped_file.h"
+#include "utils/trace.h"
+#include "utils/op_profiler.h"
+#include "utils/metrics.h"
 
 #include "asrconfig.hpp"
 #include "tokenizer.hpp"
 #include "wavfrontend.h"
+#include "resampler.h"
 
 // #define USE_CPU
 
+// process wide recognition metrics, see Metrics::global().prometheus()
+struct AsrMetrics
+{
+    Counter& chunks = Metrics::global().counter("asr_chunks_total", "Chunks recognized");
+    Counter& audio_seconds = Metrics::global().counter("asr_audio_seconds_total", "Seconds of audio recognized");
+    Histogram& rtf = Metrics::global().histogram("asr_chunk_rtf", "Real time factor of a chunk",
+                                                 {0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2});
+    Histogram& frontend = stage("frontend");
+    Histogram& encoder = stage("encoder");
+    Histogram& cif = stage("cif");
+    Histogram& decoder = stage("decoder");
+    Histogram& batch_size = Metrics::global().histogram("asr_batch_size", "Utterances per offline batch",
+                                                        {1, 2, 4, 8, 16, 32, 64});
+
+    static AsrMetrics& get()
+    {
+        static AsrMetrics metrics;
+        return metrics;
+    }
+
+    static Histogram& stage(const char* name)
+    {
+        return Metrics::global().histogram("asr_stage_seconds", "Latency of a recognition stage",
+                                           {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1},
+                                           std::string("stage=\"") + name + "\"");
+    }
+
+    static double since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// memory of everything allocated on the runtime, in bytes
+static size_t runtime_memory(const std::shared_ptr<MNN::Express::Executor::RuntimeManager>& runtime)
+{
+    float mb = 0.f;
+    if (!runtime || !runtime->getInfo(MNN::Interpreter::MEMORY, &mb))
+    {
+        return 0;
+    }
+    return static_cast<size_t>(mb * 1024 * 1024);
+}
+
+// resident set of the process in bytes, 0 where /proc isn't available
+static size_t resident_memory()
+{
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident))
+    {
+        return 0;
+    }
+    return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+static size_t var_bytes(MNN::Express::VARP var)
+{
+    auto info = var.get() ? var->getInfo() : nullptr;
+    return info ? static_cast<size_t>(info->size) * info->type.bytes() : 0;
+}
+
 
 struct OnlineCache
 {
@@ -30,7 +103,16 @@ struct OnlineCache
     MNN::Express::VARP cif_alphas;
     MNN::Express::VARP feats;
     std::vector<MNN::Express::VARP> decoder_fsmn;
+    // stateful encoder: per-layer left context k/v and encoder output of left frames
+    std::vector<MNN::Express::VARP> encoder_sanm;
+    MNN::Express::VARP encoder_left;
+    // tokens of the current utterance
     std::vector<int> tokens;
+    // endpoint detection
+    int silence_ms = 0;
+    int inactive_ms = 0;
+    int utterance_ms = 0;
+    bool endpoint = false;
 };
 
 namespace SR
@@ -46,6 +128,27 @@ namespace SR
         std::vector<float> data(std::accumulate(dims.begin(), dims.end(), 1, std::multiplies<int>()), 0);
         return MNN::Express::_Const(data.data(), dims, MNN::Express::NCHW, halide_type_of<float>());
     }
+
+    // slice `length` frames from `start` along dim 1 of a {1, T, D} or {1, T} var
+    static inline MNN::Express::VARP _slice_frames(MNN::Express::VARP x, int start, int length)
+    {
+        int rank = static_cast<int>(x->getInfo()->dim.size());
+        std::vector<int> starts(rank, 0), sizes(rank, -1);
+        starts[1] = start;
+        sizes[1] = length;
+        return MNN::Express::_Slice(x, _var<int>(starts, {rank}), _var<int>(sizes, {rank}));
+    }
+
+    // zero pad dim 1 of a {1, T, D} var up to `length` frames
+    static inline MNN::Express::VARP _pad_frames(MNN::Express::VARP x, int length)
+    {
+        int padding_length = length - x->getInfo()->dim[1];
+        if (padding_length <= 0)
+        {
+            return x;
+        }
+        return MNN::Express::_Pad(x, _var<int>({0, 0, 0, padding_length, 0, 0}, {3, 2}));
+    }
 }
 
 
@@ -179,16 +282,18 @@ void dump_var(MNN::Express::VARP var)
 }
 
 
-MNN::Express::VARP SR::Asr::position_encoding(MNN::Express::VARP samples)
+MNN::Express::VARP SR::Asr::position_encoding(MNN::Express::VARP samples, int start_idx)
 {
+    // reading the features computes them, that is the frontend's time
     auto ptr = (float*)samples->readMap<float>();
+    TRACE_SCOPE("position_encoding");
     auto dims = samples->getInfo()->dim;
     int length = dims[1];
     int feat_dims = dims[2];
     constexpr float neglog_timescale = -0.03301197265941284;
     for (int i = 0; i < length; i++)
     {
-        int offset = i + 1 + cache_->start_idx;
+        int offset = i + 1 + start_idx;
         for (int j = 0; j < feat_dims / 2; j++)
         {
             float inv_timescale = offset * std::exp(j * neglog_timescale);
@@ -196,30 +301,280 @@ MNN::Express::VARP SR::Asr::position_encoding(MNN::Express::VARP samples)
             ptr[i * feat_dims + j + feat_dims / 2] += std::cos(inv_timescale);
         }
     }
-    cache_->start_idx += length;
     return samples;
 }
 
 void SR::Asr::init_cache(int batch_size)
 {
-    cache_.reset(new OnlineCache);
-    cache_->start_idx = 0;
-    cache_->is_final = false;
-    cache_->last_chunk = false;
-    cache_->chunk_size = chunk_size_;
-    cache_->cif_hidden = SR::_zeros({batch_size, 1, config_->encoder_output_size()});
-    cache_->cif_alphas = SR::_zeros({batch_size, 1});
-    cache_->feats = SR::_zeros({batch_size, chunk_size_[0] + chunk_size_[2], feats_dims_});
-    for (int i = 0; i < config_->fsmn_layer(); i++)
+    // zero states are built once, a reset only re-points the cache at them and
+    // keeps the capacity of its vectors
+    if (!zero_cache_)
+    {
+        zero_cache_.reset(new OnlineCache);
+        zero_cache_->chunk_size = chunk_size_;
+        zero_cache_->cif_hidden = SR::_zeros({batch_size, 1, config_->encoder_output_size()});
+        zero_cache_->cif_alphas = SR::_zeros({batch_size, 1});
+        zero_cache_->feats = SR::_zeros({batch_size, chunk_size_[0] + chunk_size_[2], feats_dims_});
+        for (int i = 0; i < config_->fsmn_layer(); i++)
+        {
+            zero_cache_->decoder_fsmn.emplace_back(SR::_zeros({
+                batch_size, config_->fsmn_dims(), config_->fsmn_lorder()
+            }));
+        }
+        if (config_->encoder_stateful())
+        {
+            for (int i = 0; i < config_->encoder_layers(); i++)
+            {
+                zero_cache_->encoder_sanm.emplace_back(SR::_zeros({
+                    batch_size, chunk_size_[0], 2 * config_->encoder_output_size()
+                }));
+            }
+            zero_cache_->encoder_left = SR::_zeros({batch_size, chunk_size_[0], config_->encoder_output_size()});
+        }
+    }
+    if (!cache_)
+    {
+        cache_.reset(new OnlineCache);
+    }
+    *cache_ = *zero_cache_;
+}
+
+namespace SR
+{
+    // snapshot layout: header, flags, tokens, then every cache var as rank, dims, float data,
+    // then the resampler position and history when the stream rate isn't samp_freq
+    static constexpr uint32_t SNAPSHOT_MAGIC = 0x53525341; // "ASRS"
+    static constexpr uint32_t SNAPSHOT_VERSION = 3;
+
+    template <typename T>
+    static inline void _write(std::string& out, const T* data, size_t count)
+    {
+        out.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+    }
+
+    // elements of T left in `in` after `offset`
+    template <typename T>
+    static inline size_t _remaining(const std::string& in, size_t offset)
+    {
+        return offset < in.size() ? (in.size() - offset) / sizeof(T) : 0;
+    }
+
+    template <typename T>
+    static inline bool _read(const std::string& in, size_t& offset, T* data, size_t count)
+    {
+        if (count > _remaining<T>(in, offset))
+        {
+            return false;
+        }
+        ::memcpy(data, in.data() + offset, count * sizeof(T));
+        offset += count * sizeof(T);
+        return true;
+    }
+
+    static inline void _write_var(std::string& out, MNN::Express::VARP var)
+    {
+        auto info = var->getInfo();
+        int rank = static_cast<int>(info->dim.size());
+        _write(out, &rank, 1);
+        _write(out, info->dim.data(), rank);
+        _write(out, var->readMap<float>(), info->size);
+    }
+
+    static inline bool _read_var(const std::string& in, size_t& offset, MNN::Express::VARP& var)
+    {
+        int rank = 0;
+        if (!_read(in, offset, &rank, 1) || rank < 0 || rank > 4)
+        {
+            return false;
+        }
+        std::vector<int> dims(rank);
+        if (!_read(in, offset, dims.data(), rank))
+        {
+            return false;
+        }
+        // bound the size by the bytes left before allocating, a corrupt header never allocates
+        size_t size = 1;
+        size_t limit = _remaining<float>(in, offset);
+        for (int dim : dims)
+        {
+            if (dim <= 0 || static_cast<size_t>(dim) > limit / size)
+            {
+                return false;
+            }
+            size *= dim;
+        }
+        std::vector<float> data(size);
+        if (!_read(in, offset, data.data(), data.size()))
+        {
+            return false;
+        }
+        var = MNN::Express::_Const(data.data(), dims, MNN::Express::NCHW, halide_type_of<float>());
+        return true;
+    }
+
+    static inline std::vector<int> _dims(MNN::Express::VARP var)
+    {
+        return var->getInfo()->dim;
+    }
+
+    static inline int _size(MNN::Express::VARP var)
+    {
+        return var->getInfo()->size;
+    }
+}
+
+std::string SR::Asr::snapshot() const
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    std::string out;
+    if (!cache_)
+    {
+        return out;
+    }
+    int header[] = {
+        static_cast<int>(SNAPSHOT_MAGIC), static_cast<int>(SNAPSHOT_VERSION), cache_->start_idx,
+        cache_->is_final, cache_->last_chunk, static_cast<int>(cache_->chunk_size.size()),
+        static_cast<int>(cache_->tokens.size()), static_cast<int>(cache_->decoder_fsmn.size()),
+        static_cast<int>(cache_->encoder_sanm.size()), cache_->silence_ms, cache_->inactive_ms,
+        cache_->utterance_ms, stream_rate_,
+        resampler_ ? static_cast<int>(resampler_->history().size()) : 0
+    };
+    _write(out, header, sizeof(header) / sizeof(int));
+    _write(out, cache_->chunk_size.data(), cache_->chunk_size.size());
+    _write(out, cache_->tokens.data(), cache_->tokens.size());
+    _write_var(out, cache_->cif_hidden);
+    _write_var(out, cache_->cif_alphas);
+    _write_var(out, cache_->feats);
+    for (auto fsmn : cache_->decoder_fsmn)
+    {
+        _write_var(out, fsmn);
+    }
+    for (auto sanm : cache_->encoder_sanm)
+    {
+        _write_var(out, sanm);
+    }
+    if (!cache_->encoder_sanm.empty())
+    {
+        _write_var(out, cache_->encoder_left);
+    }
+    if (resampler_)
+    {
+        int64_t position = resampler_->position();
+        _write(out, &position, 1);
+        _write(out, resampler_->history().data(), resampler_->history().size());
+    }
+    return out;
+}
+
+bool SR::Asr::restore(const std::string& snapshot)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    int header[14];
+    size_t offset = 0;
+    if (!_read(snapshot, offset, header, 14) || header[0] != static_cast<int>(SNAPSHOT_MAGIC))
+    {
+        ERROR_PRINT("Error: invalid session snapshot");
+        return false;
+    }
+    if (header[1] != static_cast<int>(SNAPSHOT_VERSION))
+    {
+        ERROR_PRINT("Error: unsupported session snapshot version: " + std::to_string(header[1]));
+        return false;
+    }
+    int encoder_layers = config_->encoder_stateful() ? config_->encoder_layers() : 0;
+    if (header[5] != static_cast<int>(chunk_size_.size()) || header[6] < 0 ||
+        static_cast<size_t>(header[6]) > _remaining<int>(snapshot, offset) ||
+        header[7] != config_->fsmn_layer() || header[8] != encoder_layers || header[2] < 0 ||
+        header[12] < MIN_SAMPLE_RATE || header[12] > MAX_SAMPLE_RATE || header[13] < 0)
+    {
+        ERROR_PRINT("Error: session snapshot does not match the loaded model");
+        return false;
+    }
+    std::shared_ptr<OnlineCache> cache(new OnlineCache);
+    cache->start_idx = header[2];
+    cache->is_final = header[3];
+    cache->last_chunk = header[4];
+    cache->chunk_size.resize(header[5]);
+    cache->tokens.resize(header[6]);
+    cache->decoder_fsmn.resize(header[7]);
+    cache->encoder_sanm.resize(header[8]);
+    cache->silence_ms = header[9];
+    cache->inactive_ms = header[10];
+    cache->utterance_ms = header[11];
+    bool is_ok = _read(snapshot, offset, cache->chunk_size.data(), cache->chunk_size.size()) &&
+        _read(snapshot, offset, cache->tokens.data(), cache->tokens.size()) &&
+        _read_var(snapshot, offset, cache->cif_hidden) &&
+        _read_var(snapshot, offset, cache->cif_alphas) &&
+        _read_var(snapshot, offset, cache->feats);
+    for (int i = 0; is_ok && i < header[7]; i++)
+    {
+        is_ok = _read_var(snapshot, offset, cache->decoder_fsmn[i]);
+    }
+    for (int i = 0; is_ok && i < header[8]; i++)
+    {
+        is_ok = _read_var(snapshot, offset, cache->encoder_sanm[i]);
+    }
+    if (is_ok && header[8] > 0)
+    {
+        is_ok = _read_var(snapshot, offset, cache->encoder_left);
+    }
+    // the stream resumes at its rate with the resampler's carried over input
+    std::shared_ptr<Resampler> resampler;
+    if (is_ok && header[12] != config_->samp_freq())
+    {
+        int64_t position = 0;
+        is_ok = _read(snapshot, offset, &position, 1) &&
+            static_cast<size_t>(header[13]) <= _remaining<float>(snapshot, offset);
+        if (is_ok)
+        {
+            std::vector<float> history(header[13]);
+            resampler.reset(new Resampler(header[12], config_->samp_freq()));
+            is_ok = _read(snapshot, offset, history.data(), history.size()) && resampler->restore(history, position);
+        }
+    }
+    if (!is_ok || cache->chunk_size != chunk_size_)
+    {
+        ERROR_PRINT("Error: truncated session snapshot or mismatched chunk_size");
+        return false;
+    }
+    // the states must have the shapes the model takes: the model caches exactly those of
+    // the zero states, the cif state its size, the overlap feats at most the zero frames
+    if (!zero_cache_)
+    {
+        init_cache();
+    }
+    auto zero = zero_cache_;
+    auto feats = _dims(cache->feats), zero_feats = _dims(zero->feats);
+    is_ok = feats.size() == zero_feats.size() && feats[0] == zero_feats[0] && feats[1] <= zero_feats[1] &&
+        feats[2] == zero_feats[2] && _size(cache->cif_hidden) == _size(zero->cif_hidden) &&
+        _size(cache->cif_alphas) == _size(zero->cif_alphas);
+    for (int i = 0; is_ok && i < header[7]; i++)
+    {
+        is_ok = _dims(cache->decoder_fsmn[i]) == _dims(zero->decoder_fsmn[i]);
+    }
+    for (int i = 0; is_ok && i < header[8]; i++)
+    {
+        is_ok = _dims(cache->encoder_sanm[i]) == _dims(zero->encoder_sanm[i]);
+    }
+    if (is_ok && header[8] > 0)
+    {
+        is_ok = _dims(cache->encoder_left) == _dims(zero->encoder_left);
+    }
+    if (!is_ok)
     {
-        cache_->decoder_fsmn.emplace_back(SR::_zeros({
-            batch_size, config_->fsmn_dims(), config_->fsmn_lorder()
-        }));
+        ERROR_PRINT("Error: session snapshot states do not match the model's cache shapes");
+        return false;
     }
+    // a fresh stream at the snapshot's rate, then its state
+    begin_stream(header[12]);
+    resampler_ = resampler;
+    cache_ = cache;
+    return true;
 }
 
 MNN::Express::VARP SR::Asr::add_overlap_chunk(MNN::Express::VARP feats)
 {
+    TRACE_SCOPE("add_overlap_chunk");
     if (!cache_) return feats;
     feats = MNN::Express::_Concat({cache_->feats, feats}, 1);
     if (cache_->is_final)
@@ -242,36 +597,17 @@ MNN::Express::VARP SR::Asr::add_overlap_chunk(MNN::Express::VARP feats)
     return feats;
 }
 
-MNN::Express::VARPS SR::Asr::cif_search(MNN::Express::VARP hidden, MNN::Express::VARP alphas)
+// continuous integrate-and-fire over {1, T, D} hidden and {1, T} alphas, `integrate` and
+// `frames` return the residual weight and the partial embedding of the last token
+static MNN::Express::VARPS cif_integrate(MNN::Express::VARP hidden, MNN::Express::VARP alphas, float cif_threshold,
+                                         float& integrate, MNN::Express::VARP& frames)
 {
-    auto chunk_alpha_ptr = const_cast<float*>(alphas->readMap<float>());
-    for (int i = 0; i < alphas->getInfo()->size; i++)
-    {
-        if (i < chunk_size_[0] || i >= chunk_size_[0] + chunk_size_[1])
-        {
-            chunk_alpha_ptr[i] = 0.f;
-        }
-    }
-    if (cache_->last_chunk)
-    {
-        int hidden_size = hidden->getInfo()->dim[2];
-        auto tail_hidden = SR::_zeros({1, 1, hidden_size});
-        auto tail_alphas = SR::_var<float>({config_->tail_threshold()}, {1, 1});
-        hidden = MNN::Express::_Concat({cache_->cif_hidden, hidden, tail_hidden}, 1);
-        alphas = MNN::Express::_Concat({cache_->cif_alphas, alphas, tail_alphas}, 1);
-    }
-    else
-    {
-        hidden = MNN::Express::_Concat({cache_->cif_hidden, hidden}, 1);
-        alphas = MNN::Express::_Concat({cache_->cif_alphas, alphas}, 1);
-    }
     auto alpha_ptr = alphas->readMap<float>();
 
     auto dims = hidden->getInfo()->dim;
-    int batch_size = dims[0], len_time = dims[1], hidden_size = dims[2];
-    auto frames = SR::_zeros({hidden_size});
-    float cif_threshold = config_->cif_threshold();
-    float integrate = 0.f;
+    int len_time = alphas->getInfo()->dim[1], hidden_size = dims[2];
+    frames = SR::_zeros({hidden_size});
+    integrate = 0.f;
     std::vector<MNN::Express::VARP> list_frame;
     for (int t = 0; t < len_time; t++)
     {
@@ -292,6 +628,36 @@ MNN::Express::VARPS SR::Asr::cif_search(MNN::Express::VARP hidden, MNN::Express:
             frames = MNN::Express::_Scalar<float>(integrate) * hidden_t;
         }
     }
+    return list_frame;
+}
+
+MNN::Express::VARPS SR::Asr::cif_search(MNN::Express::VARP hidden, MNN::Express::VARP alphas)
+{
+    TRACE_SCOPE("cif_search");
+    auto chunk_alpha_ptr = const_cast<float*>(alphas->readMap<float>());
+    for (int i = 0; i < alphas->getInfo()->size; i++)
+    {
+        if (i < chunk_size_[0] || i >= chunk_size_[0] + chunk_size_[1])
+        {
+            chunk_alpha_ptr[i] = 0.f;
+        }
+    }
+    if (cache_->last_chunk)
+    {
+        int hidden_size = hidden->getInfo()->dim[2];
+        auto tail_hidden = SR::_zeros({1, 1, hidden_size});
+        auto tail_alphas = SR::_var<float>({config_->tail_threshold()}, {1, 1});
+        hidden = MNN::Express::_Concat({cache_->cif_hidden, hidden, tail_hidden}, 1);
+        alphas = MNN::Express::_Concat({cache_->cif_alphas, alphas, tail_alphas}, 1);
+    }
+    else
+    {
+        hidden = MNN::Express::_Concat({cache_->cif_hidden, hidden}, 1);
+        alphas = MNN::Express::_Concat({cache_->cif_alphas, alphas}, 1);
+    }
+    float integrate = 0.f;
+    MNN::Express::VARP frames;
+    auto list_frame = cif_integrate(hidden, alphas, config_->cif_threshold(), integrate, frames);
     // update cache
     cache_->cif_alphas = SR::_var<float>({integrate}, {1, 1});
     cache_->cif_hidden = integrate > 0.f ? (frames / MNN::Express::_Scalar<float>(integrate)) : frames;
@@ -299,10 +665,9 @@ MNN::Express::VARPS SR::Asr::cif_search(MNN::Express::VARP hidden, MNN::Express:
 }
 
 
-std::string SR::Asr::decode(MNN::Express::VARP logits)
+std::string SR::Asr::decode(const int* token_ptr, int token_num, std::vector<int>* tokens)
 {
-    int token_num = logits->getInfo()->dim[1];
-    auto token_ptr = _ArgMax(logits, -1)->readMap<int>();
+    TRACE_SCOPE("decode");
     std::string text;
     for (int i = 0; i < token_num; i++)
     {
@@ -311,7 +676,10 @@ std::string SR::Asr::decode(MNN::Express::VARP logits)
         {
             continue;
         }
-        cache_->tokens.push_back(token);
+        if (tokens)
+        {
+            tokens->push_back(token);
+        }
         auto symbol = tokenizer_->decode(token);
         // end with '@@'
         if (symbol.size() > 2 && symbol.back() == '@' && symbol[symbol.size() - 2] == '@')
@@ -330,21 +698,69 @@ std::string SR::Asr::decode(MNN::Express::VARP logits)
     return text;
 }
 
-std::string SR::Asr::infer(MNN::Express::VARP feats)
+MNN::Express::VARPS SR::Asr::encode(MNN::Express::VARP feats)
 {
-    auto enc_len = MNN::Express::_Input({1}, MNN::Express::NCHW, halide_type_of<int>());
-    enc_len->writeMap<int>()[0] = feats->getInfo()->dim[1];
-    auto encoder_outputs = modules_[0]->onForward({feats, enc_len});
-    auto alphas = encoder_outputs[0];
-    auto enc = encoder_outputs[1];
-    enc_len = encoder_outputs[2];
-    auto acoustic_embeds_list = cif_search(enc, alphas);
-    if (acoustic_embeds_list.empty())
+    TRACE_SCOPE("encoder");
+    if (op_profiler_)
     {
-        return "";
+        op_profiler_->scope("encoder");
     }
-    auto acoustic_embeds = MNN::Express::_Concat(acoustic_embeds_list, 1);
-    int acoustic_embeds_len = static_cast<int>(acoustic_embeds_list.size());
+    int length = feats->getInfo()->dim[1];
+    bool static_shape = config_->static_shape();
+    if (!config_->encoder_stateful())
+    {
+        int window = std::accumulate(chunk_size_.begin(), chunk_size_.end(), 0);
+        if (static_shape && length < window)
+        {
+            feats = SR::_pad_frames(feats, window);
+        }
+        auto enc_len = MNN::Express::_Input({1}, MNN::Express::NCHW, halide_type_of<int>());
+        enc_len->writeMap<int>()[0] = length;
+        auto encoder_outputs = modules_[0]->onForward({feats, enc_len});
+        if (static_shape && length < window)
+        {
+            // padded frames are masked by enc_len, drop their alphas
+            encoder_outputs[0] = SR::_slice_frames(encoder_outputs[0], 0, length);
+        }
+        return encoder_outputs;
+    }
+    // stateful encoder only computes [center | right], the left context of the
+    // window is served from the per-layer caches of the previous chunk
+    int left = chunk_size_[0];
+    auto enc = cache_->encoder_left;
+    auto alphas = SR::_zeros({1, left});
+    if (length > left)
+    {
+        int frames = length - left;
+        auto speech = SR::_slice_frames(feats, left, frames);
+        if (static_shape)
+        {
+            speech = SR::_pad_frames(speech, chunk_size_[1] + chunk_size_[2]);
+        }
+        MNN::Express::VARPS encoder_inputs{speech, SR::_var<int>({frames}, {1})};
+        for (auto sanm : cache_->encoder_sanm)
+        {
+            encoder_inputs.push_back(sanm);
+        }
+        auto encoder_outputs = modules_[0]->onForward(encoder_inputs);
+        for (int i = 0; i < config_->encoder_layers(); i++)
+        {
+            cache_->encoder_sanm[i] = encoder_outputs[2 + i];
+        }
+        // keep window coordinates for cif_search and the decoder
+        alphas = MNN::Express::_Concat({alphas, SR::_slice_frames(encoder_outputs[0], 0, frames)}, 1);
+        enc = MNN::Express::_Concat({enc, encoder_outputs[1]}, 1);
+        if (frames >= chunk_size_[1])
+        {
+            cache_->encoder_left = SR::_slice_frames(encoder_outputs[1], chunk_size_[1] - left, left);
+        }
+    }
+    return {alphas, enc, SR::_var<int>({length}, {1})};
+}
+
+std::string SR::Asr::forward_decoder(MNN::Express::VARP enc, MNN::Express::VARP enc_len,
+                                     MNN::Express::VARP acoustic_embeds, int acoustic_embeds_len)
+{
     MNN::Express::VARPS decocder_inputs{
         enc, enc_len, acoustic_embeds, SR::_var<int>({acoustic_embeds_len}, {1})
     };
@@ -352,99 +768,705 @@ std::string SR::Asr::infer(MNN::Express::VARP feats)
     {
         decocder_inputs.push_back(fsmn);
     }
-    auto decoder_outputs = modules_[1]->onForward(decocder_inputs);
+    auto start = std::chrono::steady_clock::now();
+    MNN::Express::VARPS decoder_outputs;
+    if (op_profiler_)
+    {
+        op_profiler_->scope("decoder");
+    }
+    {
+        TRACE_SCOPE("decoder");
+        decoder_outputs = modules_[1]->onForward(decocder_inputs);
+    }
 
-    auto logits = decoder_outputs[0];
+    // argmax is computed in-graph, only the token ids are read back
+    auto token_ids = decoder_outputs[0];
     for (int i = 0; i < config_->fsmn_layer(); i++)
     {
-        cache_->decoder_fsmn[i] = decoder_outputs[2 + i];
+        cache_->decoder_fsmn[i] = decoder_outputs[1 + i];
     }
-    auto text = decode(logits);
-    // printf("%s", text.c_str());
+    stage_end("decoder", token_ids);
+    auto text = decode(token_ids->readMap<int>(), acoustic_embeds_len, &cache_->tokens);
+    stage_end("detokenize");
+    AsrMetrics::get().decoder.observe(AsrMetrics::since(start));
     return text;
 }
 
-// std::string Asr::recognize(std::vector<float>& waveforms) {
-std::string SR::Asr::recognize(MNN::Express::VARP waveforms)
+MNN::Express::VARPS SR::Asr::encode_window(MNN::Express::VARP feats, bool last_chunk)
 {
-    Timer timer;
-    size_t wave_length = waveforms->getInfo()->size;
-    if (wave_length < 16 * 60 && cache_->is_final)
+    cache_->last_chunk = last_chunk;
+    auto& metrics = AsrMetrics::get();
+    auto start = std::chrono::steady_clock::now();
+    auto encoder_outputs = encode(feats);
+    metrics.encoder.observe(AsrMetrics::since(start));
+    start = std::chrono::steady_clock::now();
+    auto alphas = encoder_outputs[0];
+    auto enc = encoder_outputs[1];
+    auto enc_len = encoder_outputs[2];
+    stage_end("encoder", enc);
+    auto hidden = enc;
+    int frames = alphas->getInfo()->dim[1];
+    if (enc->getInfo()->dim[1] > frames)
     {
-        cache_->last_chunk = true;
-        return infer(cache_->feats);
+        hidden = SR::_slice_frames(enc, 0, frames);
     }
-    // auto t1 = std::chrono::system_clock::now();
-    auto feats = frontend_->extract_feat(waveforms);
-    // std::cout << "feats time: " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - t1).count() << std::endl;
+    auto acoustic_embeds_list = cif_search(hidden, alphas);
+    metrics.cif.observe(AsrMetrics::since(start));
+    if (acoustic_embeds_list.empty())
+    {
+        stage_end("cif");
+        return {enc, enc_len};
+    }
+    auto acoustic_embeds = MNN::Express::_Concat(acoustic_embeds_list, 1);
+    stage_end("cif", acoustic_embeds);
+    return {enc, enc_len, acoustic_embeds};
+}
 
-    feats = feats * MNN::Express::_Scalar<float>(std::sqrt(config_->encoder_output_size()));
-    feats = position_encoding(feats);
-    if (cache_->is_final)
+std::string SR::Asr::decode_window(const MNN::Express::VARPS& encoded)
+{
+    if (encoded.size() < 3)
     {
-        auto dims = feats->getInfo()->dim;
-        if (dims[1] + chunk_size_[2] <= chunk_size_[1])
-        {
-            cache_->last_chunk = true;
-            feats = add_overlap_chunk(feats);
-        }
-        else
-        {
-            // first chunk
-            auto feats1 = feats;
-            if (dims[1] > chunk_size_[1])
-            {
-                feats1 = MNN::Express::_Slice(feats, SR::_var<int>({0, 0, 0}, {3}),
-                                              SR::_var<int>({-1, chunk_size_[1], -1}, {3}));
-            }
-            auto feats_chunk1 = add_overlap_chunk(feats1);
-            auto res1 = infer(feats_chunk1);
-            // last chunk
-            cache_->last_chunk = true;
-            auto feat2 = feats;
-            int start = dims[1] + chunk_size_[2] - chunk_size_[1];
-            if (start != 0)
-            {
-                feat2 = MNN::Express::_Slice(feats, SR::_var<int>({0, -start, 0}, {3}),
-                                             SR::_var<int>({-1, -1, -1}, {3}));
-            }
-            auto feats_chunk2 = add_overlap_chunk(feat2);
-            auto res2 = infer(feats_chunk2);
-            return res1 + res2;
-        }
+        return "";
     }
-    else
+    auto enc = encoded[0];
+    auto enc_len = encoded[1];
+    auto acoustic_embeds = encoded[2];
+    int acoustic_embeds_len = acoustic_embeds->getInfo()->dim[1];
+    if (!config_->static_shape())
     {
-        feats = add_overlap_chunk(feats);
+        return forward_decoder(enc, enc_len, acoustic_embeds, acoustic_embeds_len);
     }
+    // static decoder: fixed window and `max_tokens` embeds, padded tokens are masked by
+    // acoustic_embeds_len; the decoder is causal over tokens so longer runs are split
+    int window = std::accumulate(chunk_size_.begin(), chunk_size_.end(), 0);
+    if (enc->getInfo()->dim[1] < window)
+    {
+        enc = SR::_pad_frames(enc, window);
+    }
+    int max_tokens = config_->max_tokens();
+    std::string text;
+    for (int i = 0; i < acoustic_embeds_len; i += max_tokens)
+    {
+        int token_num = std::min(max_tokens, acoustic_embeds_len - i);
+        auto embeds = SR::_pad_frames(SR::_slice_frames(acoustic_embeds, i, token_num), max_tokens);
+        text += forward_decoder(enc, enc_len, embeds, token_num);
+    }
+    return text;
+}
 
-    DEBUG_PRINT(timer.TimingStr("preprocess"));
-    std::string result = infer(feats);
-
-    DEBUG_PRINT(timer.TimingStr("recognize"));
-    return result;
+std::string SR::Asr::infer(MNN::Express::VARP feats)
+{
+    return decode_window(encode_window(feats, cache_->last_chunk));
 }
 
-void SR::Asr::online_recognize(const std::string& wav_file)
+std::vector<std::string> SR::Asr::offline_batch(const std::vector<MNN::Express::VARP>& feats_list)
 {
-    Timer timer, timer_total;
-    LOG_PRINT("load wav file from: " + wav_file);
-    bool is_ok = false;
-#if 0
-    std::vector<float> speech = read_wave(wav_file, &sample_rate, &is_ok);
-    if (!is_ok) {
-        fprintf(stderr, "Failed to read '%s'\n", wav_file.c_str());
-        return;
+    int batch_size = static_cast<int>(feats_list.size());
+    int hidden_size = config_->encoder_output_size();
+    AsrMetrics::get().batch_size.observe(batch_size);
+    std::vector<int> lengths;
+    int max_length = 0;
+    for (auto feats : feats_list)
+    {
+        lengths.push_back(feats->getInfo()->dim[1]);
+        max_length = std::max(max_length, lengths.back());
     }
-    float mean_val = std::accumulate(speech.begin(), speech.end(), 0.f) / speech.size();
-    std::cout << "### wav file: " << wav_file << ", mean_val: " << mean_val << std::endl;
-    auto speech_length = speech.size();
-#else
-    auto audio_file = MNN::AUDIO::load(wav_file);
-    auto speech = audio_file.first;
-    int sample_rate = audio_file.second;
-    auto speech_length = speech->getInfo()->size;
-    auto speech_ptr = speech->readMap<int>();
+    // {B, T, feats_dims} padded speech, enc_len masks the padded frames
+    MNN::Express::VARPS padded;
+    for (auto feats : feats_list)
+    {
+        padded.push_back(SR::_pad_frames(feats, max_length));
+    }
+    MNN::Express::VARPS encoder_outputs;
+    if (op_profiler_)
+    {
+        op_profiler_->scope("encoder");
+    }
+    {
+        TRACE_SCOPE("encoder");
+        encoder_outputs = modules_[0]->onForward({MNN::Express::_Concat(padded, 0), SR::_var<int>(lengths, {batch_size})});
+    }
+    auto alphas = encoder_outputs[0];
+    auto enc = encoder_outputs[1];
+
+    // integrate every item over its own frames, with the tail weight appended
+    std::vector<MNN::Express::VARPS> embeds_list(batch_size);
+    int max_tokens = 0;
+    for (int b = 0; b < batch_size; b++)
+    {
+        auto hidden_b = MNN::Express::_Slice(enc, SR::_var<int>({b, 0, 0}, {3}),
+                                             SR::_var<int>({1, lengths[b], -1}, {3}));
+        auto alphas_b = MNN::Express::_Slice(alphas, SR::_var<int>({b, 0}, {2}),
+                                             SR::_var<int>({1, lengths[b]}, {2}));
+        hidden_b = MNN::Express::_Concat({hidden_b, SR::_zeros({1, 1, hidden_size})}, 1);
+        alphas_b = MNN::Express::_Concat({alphas_b, SR::_var<float>({config_->tail_threshold()}, {1, 1})}, 1);
+        float integrate = 0.f;
+        MNN::Express::VARP frames;
+        embeds_list[b] = cif_integrate(hidden_b, alphas_b, config_->cif_threshold(), integrate, frames);
+        max_tokens = std::max(max_tokens, static_cast<int>(embeds_list[b].size()));
+    }
+    std::vector<std::string> texts(batch_size);
+    if (max_tokens == 0)
+    {
+        return texts;
+    }
+
+    // {B, N, hidden} padded acoustic embeds, items without tokens get one masked zero embed
+    MNN::Express::VARPS acoustic_embeds;
+    std::vector<int> acoustic_embeds_len;
+    for (auto& embeds : embeds_list)
+    {
+        auto embed = embeds.empty() ? SR::_zeros({1, 1, hidden_size}) : MNN::Express::_Concat(embeds, 1);
+        acoustic_embeds.push_back(SR::_pad_frames(embed, max_tokens));
+        acoustic_embeds_len.push_back(std::max(1, static_cast<int>(embeds.size())));
+    }
+    MNN::Express::VARPS decocder_inputs{
+        enc, encoder_outputs[2], MNN::Express::_Concat(acoustic_embeds, 0),
+        SR::_var<int>(acoustic_embeds_len, {batch_size})
+    };
+    for (int i = 0; i < config_->fsmn_layer(); i++)
+    {
+        decocder_inputs.push_back(SR::_zeros({batch_size, config_->fsmn_dims(), config_->fsmn_lorder()}));
+    }
+    const int* token_ptr = nullptr;
+    if (op_profiler_)
+    {
+        op_profiler_->scope("decoder");
+    }
+    {
+        TRACE_SCOPE("decoder");
+        token_ptr = modules_[1]->onForward(decocder_inputs)[0]->readMap<int>();
+    }
+    for (int b = 0; b < batch_size; b++)
+    {
+        texts[b] = decode(token_ptr + b * max_tokens, static_cast<int>(embeds_list[b].size()));
+    }
+    return texts;
+}
+
+std::vector<std::string> SR::Asr::offline_recognize(const std::vector<MNN::Express::VARP>& speeches,
+                                                    const std::vector<int>& sample_rates)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    std::vector<std::string> texts(speeches.size());
+    if (config_->static_shape() || config_->encoder_stateful())
+    {
+        // chunk shaped models can't take whole utterances, run them as streams
+        WARNING_PRINT("offline batching needs the dynamic shape models, fall back to streaming");
+        for (size_t i = 0; i < speeches.size(); i++)
+        {
+            texts[i] = online_recognize(speeches[i], sample_rates.empty() ? config_->samp_freq() : sample_rates[i]);
+        }
+        return texts;
+    }
+    Timer timer;
+    std::vector<MNN::Express::VARP> feats_list(speeches.size());
+    std::vector<int> order;
+    for (size_t i = 0; i < speeches.size(); i++)
+    {
+        auto speech = speeches[i];
+        if (!sample_rates.empty() && sample_rates[i] != config_->samp_freq())
+        {
+            speech = Resampler(sample_rates[i], config_->samp_freq()).process(speech, true);
+        }
+        if (speech->getInfo()->size < 16 * 60)
+        {
+            continue;
+        }
+        MNN::Express::VARP feats;
+        {
+            TRACE_SCOPE("extract_feat");
+            feats = frontend_->extract_feat(speech);
+            feats = feats * MNN::Express::_Scalar<float>(std::sqrt(config_->encoder_output_size()));
+            if (Tracer::enabled())
+            {
+                feats->readMap<float>();
+            }
+        }
+        feats_list[i] = position_encoding(feats, 0);
+        order.push_back(static_cast<int>(i));
+    }
+    DEBUG_PRINT(timer.TimingStr("offline preprocess"));
+    // length buckets: sorted by frames, a bucket ends at batch_size items or when the
+    // longest item would exceed bucket_ratio times the shortest one
+    auto frames = [&](int i) { return feats_list[i]->getInfo()->dim[1]; };
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return frames(a) < frames(b); });
+    int batch_size = std::max(1, config_->batch_size());
+    float bucket_ratio = config_->bucket_ratio();
+    for (size_t begin = 0; begin < order.size();)
+    {
+        size_t end = begin + 1;
+        while (end < order.size() && end - begin < static_cast<size_t>(batch_size) &&
+            frames(order[end]) <= frames(order[begin]) * bucket_ratio)
+        {
+            end++;
+        }
+        std::vector<MNN::Express::VARP> batch;
+        for (size_t i = begin; i < end; i++)
+        {
+            batch.push_back(feats_list[order[i]]);
+        }
+        auto batch_texts = offline_batch(batch);
+        for (size_t i = begin; i < end; i++)
+        {
+            texts[order[i]] = batch_texts[i - begin];
+        }
+        begin = end;
+    }
+    DEBUG_PRINT(timer.TimingStr("offline recognize"));
+    return texts;
+}
+
+std::string SR::Asr::offline_recognize(const std::string& wav_file)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    LOG_PRINT("load wav file from: " + wav_file);
+    auto audio_file = MNN::AUDIO::load(wav_file);
+    auto text = offline_recognize(std::vector<MNN::Express::VARP>{audio_file.first}, {audio_file.second})[0];
+    LOG_PRINT(text);
+    return text;
+}
+
+// std::string Asr::recognize(std::vector<float>& waveforms) {
+bool SR::Asr::begin_stream(int sample_rate)
+{
+    sample_rate = sample_rate ? sample_rate : config_->samp_freq();
+    if (sample_rate < MIN_SAMPLE_RATE || sample_rate > MAX_SAMPLE_RATE)
+    {
+        ERROR_PRINT("Error: unsupported sample rate: " + std::to_string(sample_rate));
+        return false;
+    }
+    MNN::Express::ExecutorScope scope(executor_);
+    init_cache();
+    stream_rate_ = sample_rate;
+    resampler_.reset();
+    if (stream_rate_ != config_->samp_freq())
+    {
+        resampler_.reset(new Resampler(stream_rate_, config_->samp_freq()));
+    }
+    size_t capacity = static_cast<size_t>(stream_rate_) * config_->ingest_ms() / 1000;
+    if (!ring_ || ring_->shared() || ring_->capacity() < capacity)
+    {
+        ring_.reset(new PcmRing(capacity));
+    }
+    ring_->reset();
+    return true;
+}
+
+void SR::Asr::warmup()
+{
+    Timer timer;
+    int rate = config_->samp_freq();
+    silent_chunk(rate);
+    // the workspace of a clone is allocated on its own executor and missing from the shared
+    // runtime's memory info: a clone runs a chunk and the process growth is the per stream
+    // memory. the weights are paged in by now, the chunk's state counts where /proc is missing
+    size_t before = resident_memory();
+    std::unique_ptr<Asr> probe(clone());
+    if (probe)
+    {
+        probe->silent_chunk(rate);
+        size_t after = resident_memory();
+        stream_memory_ = std::max(after > before ? after - before : 0, probe->session_memory());
+    }
+    begin_stream(rate);
+    DEBUG_PRINT(timer.TimingStr("warmup"));
+}
+
+void SR::Asr::silent_chunk(int sample_rate)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    begin_stream(sample_rate);
+    std::vector<float> silence(chunk_samples(sample_rate), 0.f);
+    recognize(MNN::Express::_Const(silence.data(), {static_cast<int>(silence.size())}, MNN::Express::NHWC,
+                                   halide_type_of<float>()), true);
+}
+
+int SR::Asr::chunk_samples(int sample_rate) const
+{
+    // chunk_size_[1] lfr frames at the input rate, resampled inside the stream
+    return static_cast<int>(static_cast<int64_t>(chunk_size_[1]) * config_->lfr_n() *
+                            config_->frame_shift_ms() * sample_rate / 1000);
+}
+
+size_t SR::Asr::feed(const float* pcm, size_t size)
+{
+    return ring_ ? ring_->push(pcm, size) : 0;
+}
+
+bool SR::Asr::attach_stream(const std::string& name)
+{
+    std::shared_ptr<PcmRing> ring(PcmRing::open_shared(name));
+    if (!ring)
+    {
+        ERROR_PRINT("Error: unable to map the shared pcm ring: " + name);
+        return false;
+    }
+    // the rate comes from another process and sizes the resampler
+    if (!begin_stream(ring->sample_rate()))
+    {
+        return false;
+    }
+    ring_ = ring;
+    return true;
+}
+
+bool SR::Asr::stream_ready() const
+{
+    return ring_ && (ring_->finished() || ring_->available() >= static_cast<size_t>(chunk_samples(stream_rate_)));
+}
+
+bool SR::Asr::end_stream()
+{
+    return ring_ && ring_->finish();
+}
+
+void SR::Asr::next_stream()
+{
+    init_cache();
+    if (resampler_)
+    {
+        resampler_.reset(new Resampler(stream_rate_, config_->samp_freq()));
+    }
+    // the producer may already be feeding the next stream, it starts at the end mark
+    ring_->next_stream();
+}
+
+std::string SR::Asr::recognize_pending(bool* stream_end)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    std::string text;
+    if (!ring_)
+    {
+        return text;
+    }
+    size_t chunk = chunk_samples(stream_rate_);
+    ring_chunk_.resize(chunk);
+    while (true)
+    {
+        // read the flag first, every sample pushed before end_stream() is then available
+        bool finished = ring_->finished();
+        size_t available = ring_->available();
+        if (available > chunk || (available == chunk && !finished))
+        {
+            // chunks that don't wrap are read in place, from a shared ring too
+            auto pcm = ring_->peek(chunk);
+            if (pcm)
+            {
+                MNN::Express::Variable::Info info;
+                info.dim = {static_cast<int>(chunk)};
+                info.type = halide_type_of<float>();
+                info.syncSize();
+                auto speech = MNN::Express::Variable::create(MNN::Express::Expr::create(
+                    std::move(info), pcm, MNN::Express::VARP::CONSTANT, MNN::Express::Expr::REF));
+                text += recognize(speech);
+                // the overlap frames kept for the next chunk must not reference the ring
+                cache_->feats.fix(MNN::Express::VARP::CONSTANT);
+                ring_->consume(chunk);
+                continue;
+            }
+            ring_->pop(ring_chunk_.data(), chunk);
+            text += recognize(MNN::Express::_Const(ring_chunk_.data(), {static_cast<int>(chunk)},
+                                                   MNN::Express::NHWC, halide_type_of<float>()));
+            continue;
+        }
+        if (finished)
+        {
+            size_t size = ring_->pop_some(ring_chunk_.data(), chunk);
+            text += recognize(MNN::Express::_Const(ring_chunk_.data(), {static_cast<int>(size)},
+                                                   MNN::Express::NHWC, halide_type_of<float>()), true);
+            if (ring_->shared())
+            {
+                // detach from the producer process, its ring is left untouched
+                begin_stream(stream_rate_);
+            }
+            else
+            {
+                next_stream();
+            }
+        }
+        if (stream_end)
+        {
+            *stream_end = finished;
+        }
+        return text;
+    }
+}
+
+void SR::Asr::set_stage_callback(std::function<void(const char* stage, double ms)> callback)
+{
+    stage_callback_ = callback;
+}
+
+bool SR::Asr::set_op_profiling(bool enabled)
+{
+    if (op_profiler_)
+    {
+        op_profiler_->uninstall();
+        op_profiler_.reset();
+    }
+    if (!enabled)
+    {
+        return true;
+    }
+    // the profiler serves one executor on one thread, other threads build on the global one
+    if (executor_ == MNN::Express::Executor::getGlobalExecutor())
+    {
+        ERROR_PRINT("Error: op profiling needs an executor of its own, profile a clone");
+        return false;
+    }
+    op_profiler_.reset(new OpProfiler);
+    op_profiler_->install(executor_);
+    return true;
+}
+
+std::string SR::Asr::op_profile(int top, bool json) const
+{
+    if (!op_profiler_)
+    {
+        return "";
+    }
+    return json ? op_profiler_->json(top) : op_profiler_->report(top);
+}
+
+SR::AsrMemory SR::Asr::memory() const
+{
+    AsrMemory memory;
+    memory.weights = weights_;
+    for (const auto& module : weights_)
+    {
+        memory.weights_total += module.second;
+    }
+    memory.runtime = runtime_memory(runtime_manager_);
+    memory.workspace = memory.runtime > memory.weights_total ? memory.runtime - memory.weights_total : 0;
+    memory.session_total = session_memory(&memory.session);
+    memory.peak = std::max(memory_peak_, memory.session_total);
+    memory.stream = stream_memory_ ? std::max(stream_memory_, memory.peak) : memory.workspace + memory.peak;
+    return memory;
+}
+
+size_t SR::Asr::session_memory(std::vector<std::pair<std::string, size_t>>* parts) const
+{
+    // state of a cache, vars the cache still shares with the zero states count twice
+    auto state = [](const OnlineCache* cache, size_t& feats, size_t& cif, size_t& fsmn, size_t& encoder)
+    {
+        if (!cache)
+        {
+            return;
+        }
+        feats += var_bytes(cache->feats);
+        cif += var_bytes(cache->cif_hidden) + var_bytes(cache->cif_alphas);
+        for (const auto& var : cache->decoder_fsmn)
+        {
+            fsmn += var_bytes(var);
+        }
+        for (const auto& var : cache->encoder_sanm)
+        {
+            encoder += var_bytes(var);
+        }
+        encoder += var_bytes(cache->encoder_left);
+    };
+    size_t feats = 0, cif = 0, fsmn = 0, encoder = 0, zero = 0;
+    state(cache_.get(), feats, cif, fsmn, encoder);
+    state(zero_cache_.get(), zero, zero, zero, zero);
+    size_t ingest = ring_chunk_.capacity() * sizeof(float);
+    if (ring_ && !ring_->shared())
+    {
+        ingest += ring_->capacity() * sizeof(float);
+    }
+    size_t tokens = cache_ ? cache_->tokens.capacity() * sizeof(int) : 0;
+    if (parts)
+    {
+        *parts = {{"feats", feats}, {"cif", cif}, {"decoder_fsmn", fsmn}, {"encoder_cache", encoder},
+                  {"zero_state", zero}, {"ingest", ingest}, {"tokens", tokens}};
+    }
+    return feats + cif + fsmn + encoder + zero + ingest + tokens;
+}
+
+void SR::Asr::stage_begin()
+{
+    if (stage_callback_)
+    {
+        stage_start_ = std::chrono::steady_clock::now();
+    }
+}
+
+// reports the time since the previous stage ended, once `result` is computed
+void SR::Asr::stage_end(const char* stage, MNN::Express::VARP result)
+{
+    if (!stage_callback_)
+    {
+        return;
+    }
+    if (result.get())
+    {
+        result->readMap<void>();
+    }
+    auto now = std::chrono::steady_clock::now();
+    stage_callback_(stage, std::chrono::duration<double, std::milli>(now - stage_start_).count());
+    stage_start_ = now;
+}
+
+std::vector<std::pair<MNN::Express::VARP, bool>> SR::Asr::frontend_windows(MNN::Express::VARP waveforms,
+                                                                           bool is_final)
+{
+    if (is_final)
+    {
+        cache_->is_final = true;
+    }
+    if (resampler_)
+    {
+        waveforms = resampler_->process(waveforms, is_final);
+        stage_end("resample", waveforms);
+    }
+    size_t wave_length = waveforms->getInfo()->size;
+    if (wave_length < 16 * 60 && cache_->is_final)
+    {
+        cache_->last_chunk = true;
+        return {{cache_->feats, true}};
+    }
+    MNN::Express::VARP feats;
+    {
+        TRACE_SCOPE("extract_feat");
+        feats = frontend_->fbank(waveforms);
+        stage_end("fbank", feats);
+        feats = frontend_->apply_cmvn(frontend_->apply_lfr(feats));
+        feats = feats * MNN::Express::_Scalar<float>(std::sqrt(config_->encoder_output_size()));
+        stage_end("lfr_cmvn", feats);
+        // the span times the compute, not only the graph building
+        if (Tracer::enabled())
+        {
+            feats->readMap<float>();
+        }
+    }
+    feats = position_encoding(feats, cache_->start_idx);
+    stage_end("position_encoding");
+    cache_->start_idx += feats->getInfo()->dim[1];
+    if (!cache_->is_final)
+    {
+        return {{add_overlap_chunk(feats), false}};
+    }
+    auto dims = feats->getInfo()->dim;
+    if (dims[1] + chunk_size_[2] <= chunk_size_[1])
+    {
+        cache_->last_chunk = true;
+        return {{add_overlap_chunk(feats), true}};
+    }
+    // first chunk
+    auto feats1 = feats;
+    if (dims[1] > chunk_size_[1])
+    {
+        feats1 = MNN::Express::_Slice(feats, SR::_var<int>({0, 0, 0}, {3}),
+                                      SR::_var<int>({-1, chunk_size_[1], -1}, {3}));
+    }
+    auto feats_chunk1 = add_overlap_chunk(feats1);
+    // last chunk
+    cache_->last_chunk = true;
+    auto feat2 = feats;
+    int start = dims[1] + chunk_size_[2] - chunk_size_[1];
+    if (start != 0)
+    {
+        feat2 = MNN::Express::_Slice(feats, SR::_var<int>({0, -start, 0}, {3}),
+                                     SR::_var<int>({-1, -1, -1}, {3}));
+    }
+    auto feats_chunk2 = add_overlap_chunk(feat2);
+    return {{feats_chunk1, false}, {feats_chunk2, true}};
+}
+
+std::string SR::Asr::recognize(MNN::Express::VARP waveforms, bool is_final)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    TRACE_SCOPE("recognize");
+    Timer timer;
+    auto& metrics = AsrMetrics::get();
+    auto start = std::chrono::steady_clock::now();
+    double audio_seconds = static_cast<double>(waveforms->getInfo()->size) / stream_rate_;
+    stage_begin();
+    cache_->endpoint = false;
+    auto windows = frontend_windows(waveforms, is_final);
+    metrics.frontend.observe(AsrMetrics::since(start));
+    DEBUG_PRINT(timer.TimingStr("preprocess"));
+    std::string result;
+    for (const auto& window : windows)
+    {
+        cache_->last_chunk = window.second;
+        result += infer(window.first);
+    }
+    if (!cache_->is_final && detect_endpoint(waveforms, result))
+    {
+        result += finalize();
+    }
+    memory_peak_ = std::max(memory_peak_, session_memory());
+
+    metrics.chunks.add();
+    metrics.audio_seconds.add(audio_seconds);
+    if (audio_seconds > 0)
+    {
+        metrics.rtf.observe(AsrMetrics::since(start) / audio_seconds);
+    }
+    DEBUG_PRINT(timer.TimingStr("recognize"));
+    return result;
+}
+
+bool SR::Asr::detect_endpoint(MNN::Express::VARP waveforms, const std::string& text)
+{
+    int silence_ms = config_->endpoint_silence_ms();
+    int inactive_ms = config_->endpoint_inactive_ms();
+    int max_ms = config_->endpoint_max_ms();
+    if (silence_ms <= 0 && inactive_ms <= 0 && max_ms <= 0)
+    {
+        return false;
+    }
+    int size = static_cast<int>(waveforms->getInfo()->size);
+    auto ptr = waveforms->readMap<float>();
+    float energy = 0.f;
+    for (int i = 0; i < size; i++)
+    {
+        energy += ptr[i] * ptr[i];
+    }
+    energy /= std::max(size, 1);
+    int sample_rate = resampler_ ? resampler_->in_rate() : config_->samp_freq();
+    int chunk_ms = static_cast<int>(static_cast<int64_t>(size) * 1000 / sample_rate);
+    cache_->utterance_ms += chunk_ms;
+    cache_->silence_ms = energy < config_->endpoint_energy() ? cache_->silence_ms + chunk_ms : 0;
+    cache_->inactive_ms = text.empty() ? cache_->inactive_ms + chunk_ms : 0;
+    return (silence_ms > 0 && cache_->silence_ms >= silence_ms) ||
+        (inactive_ms > 0 && cache_->inactive_ms >= inactive_ms) ||
+        (max_ms > 0 && cache_->utterance_ms >= max_ms);
+}
+
+std::string SR::Asr::finalize()
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    // flush the lookahead frames and the cif tail like a final chunk
+    cache_->is_final = true;
+    cache_->last_chunk = true;
+    auto text = infer(cache_->feats);
+    bool has_utterance = !cache_->tokens.empty();
+    init_cache();
+    cache_->endpoint = has_utterance;
+    return text;
+}
+
+bool SR::Asr::is_endpoint() const
+{
+    return cache_ && cache_->endpoint;
+}
+
+std::string SR::Asr::online_recognize(const std::string& wav_file)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    LOG_PRINT("load wav file from: " + wav_file);
+    auto audio_file = MNN::AUDIO::load(wav_file);
+    return online_recognize(audio_file.first, audio_file.second);
+}
+
+std::string SR::Asr::online_recognize(MNN::Express::VARP speech, int sample_rate)
+{
+    MNN::Express::ExecutorScope scope(executor_);
+    Timer timer, timer_total;
+    auto speech_length = speech->getInfo()->size;
+    auto speech_ptr = speech->readMap<int>();
     int start = 0;
     int end = speech_length - 1;
     int frame_length = speech_length / sample_rate; // second
@@ -469,30 +1491,38 @@ void SR::Asr::online_recognize(const std::string& wav_file)
         end--;
     }
     speech_length = end - start + 1;
-#endif
-    int chunk_size = chunk_size_[1] * 960;
+    if (!begin_stream(sample_rate))
+    {
+        return "";
+    }
+    int chunk_size = chunk_samples(sample_rate);
     int steps = DIV_UP(speech_length, chunk_size);
-    init_cache();
-    std::string total = "";
+    std::string total = "", utterance = "";
     for (int i = 0; i < steps; i++)
     {
         int deal_size = chunk_size;
-        if (i == steps - 1)
+        bool is_final = i == steps - 1;
+        if (is_final)
         {
-            cache_->is_final = true;
             deal_size = speech_length - i * chunk_size;
         }
         // std::vector<float> chunk(speech.begin() + i * chunk_size, speech.begin() + i * chunk_size + deal_size);
         auto chunk = MNN::Express::_Slice(speech, SR::_var<int>({i * chunk_size + start}, {1}),
                                           SR::_var<int>({deal_size}, {1}));
         DEBUG_PRINT(timer.TimingStr("preprocess"));
-        auto res = recognize(chunk);
+        auto res = recognize(chunk, is_final);
         DEBUG_PRINT("preds: " + res);
-        total += res;
+        utterance += res;
+        if (is_endpoint() || is_final)
+        {
+            LOG_PRINT(utterance);
+            total += utterance;
+            utterance.clear();
+        }
         timer.TimingStr("");
     }
-    LOG_PRINT(total);
     TIMING(timer_total.TimingStr("whole recognize"));
+    return total;
 }
 
 SR::Asr* SR::Asr::createASR(const std::string& config_path)
@@ -501,12 +1531,212 @@ SR::Asr* SR::Asr::createASR(const std::string& config_path)
     return new Asr(config);
 }
 
+SR::Asr::Asr(std::shared_ptr<AsrConfig> config)
+    : config_(config), stream_rate_(config->samp_freq()), cache_(nullptr),
+      executor_(MNN::Express::Executor::getGlobalExecutor())
+{
+}
+
 SR::Asr::~Asr()
 {
 }
 
-void SR::Asr::load()
+void SR::Asr::schedule_config(MNN::ScheduleConfig& config, MNN::BackendConfig& config_backend) const
+{
+    // if (MNN::BackendConfig::isOpenCLAvailable())
+#ifdef USE_GPU
+    config.type = MNN_FORWARD_CUDA;
+    config_backend.power = MNN::BackendConfig::Power_Normal;
+#else
+    config.type = MNN_FORWARD_CPU;
+    config_backend.power = MNN::BackendConfig::Power_Low;
+#endif
+    // config.type = MNN_FORWARD_VULKAN ;
+    config.numThread = config_->thread_num();
+    // low memory lets weight quantized models compute with int8 instead of dequantizing weights
+    if (config_->memory() == "low")
+    {
+        config_backend.memory = MNN::BackendConfig::Memory_Low;
+    }
+    if (config_->precision() == "low")
+    {
+        config_backend.precision = MNN::BackendConfig::Precision_Low;
+    }
+    config.backendConfig = &config_backend;
+}
+
+SR::Asr* SR::Asr::clone() const
+{
+    if (modules_.size() < 2 || !modules_[0] || !modules_[1])
+    {
+        ERROR_PRINT("Error: clone before the models are loaded");
+        return nullptr;
+    }
+    auto asr = new Asr(config_);
+    asr->tokenizer_ = tokenizer_;
+    asr->frontend_ = frontend_;
+    asr->runtime_manager_ = runtime_manager_;
+    asr->weights_ = weights_;
+    asr->stream_memory_ = stream_memory_;
+    asr->mapped_models_ = mapped_models_;
+    asr->feats_dims_ = feats_dims_;
+    asr->chunk_size_ = chunk_size_;
+    // every clone runs on its own executor with the backend, memory and precision of the
+    // loaded model and thread_num threads, module weights are shared with this instance
+    MNN::ScheduleConfig config;
+    MNN::BackendConfig backend_config;
+    schedule_config(config, backend_config);
+    asr->executor_ = MNN::Express::Executor::newExecutor(config.type, backend_config, config.numThread);
+    MNN::Express::ExecutorScope scope(asr->executor_);
+    for (const auto& module : modules_)
+    {
+        asr->modules_.emplace_back(MNN::Express::Module::clone(module.get(), true));
+    }
+    return asr;
+}
+
+std::string SR::Asr::runtime_key() const
+{
+#ifdef USE_GPU
+    std::string key = "cuda";
+#else
+    std::string key = "cpu";
+#endif
+    return key + "/" + std::to_string(config_->thread_num()) + "/" + config_->memory() + "/" +
+           config_->precision() + (config_->use_mmap() ? "/mmap" : "");
+}
+
+// stable across processes and builds (unlike std::hash): fnv-1a of the absolute path, in hex
+static std::string path_key(const std::string& path)
 {
+    char resolved[PATH_MAX];
+    std::string absolute = ::realpath(path.c_str(), resolved) ? resolved : path;
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : absolute)
+    {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+static bool make_dir(const std::string& dir)
+{
+    if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        ERROR_PRINT("Error: unable to create the weight cache directory: " + dir);
+        return false;
+    }
+    return true;
+}
+
+// remove the caches `prefix`* in `dir` other than `keep`, left by earlier versions of a model.
+// a process still mapping one of them keeps its pages until it unmaps them
+static void remove_superseded(const std::string& dir, const std::string& prefix, const std::string& keep)
+{
+    DIR* handle = opendir(dir.c_str());
+    if (!handle)
+    {
+        return;
+    }
+    while (auto entry = readdir(handle))
+    {
+        std::string name = entry->d_name;
+        if (name == keep || name.compare(0, prefix.size(), prefix) != 0)
+        {
+            continue;
+        }
+        std::string path = dir + "/" + name;
+        DIR* cache = opendir(path.c_str());
+        if (!cache)
+        {
+            continue;
+        }
+        while (auto file = readdir(cache))
+        {
+            std::string file_name = file->d_name;
+            if (file_name != "." && file_name != "..")
+            {
+                ::unlink((path + "/" + file_name).c_str());
+            }
+        }
+        closedir(cache);
+        if (::rmdir(path.c_str()) == 0)
+        {
+            INFO_PRINT("removed superseded weight cache: " + path);
+        }
+    }
+    closedir(handle);
+}
+
+MNN::Express::Module* SR::Asr::load_module(const std::vector<std::string>& inputs,
+                                           const std::vector<std::string>& outputs, const std::string& path,
+                                           const std::string& name,
+                                           const MNN::Express::Module::Config* module_config)
+{
+    // the runtime's growth is the module's weights, loads on a shared runtime overlapping
+    // in time count each other's
+    size_t before = runtime_memory(runtime_manager_);
+    if (!config_->use_mmap())
+    {
+        auto module = MNN::Express::Module::load(inputs, outputs, path.c_str(), runtime_manager_, module_config);
+        size_t after = runtime_memory(runtime_manager_);
+        if (module)
+        {
+            weights_.emplace_back(name, after > before ? after - before : 0);
+        }
+        return module;
+    }
+    std::shared_ptr<MappedFile> file(MappedFile::open(path));
+    if (!file)
+    {
+        ERROR_PRINT("Error: unable to map model file: " + path);
+        return nullptr;
+    }
+    // the weights repacked for the backend go to a mapped file per model, later loads
+    // (other processes too) map the cached file instead of repacking into private memory.
+    // the cache is keyed by the model's absolute path (configs sharing mmap_dir, e.g. float
+    // and int8 variants, keep their own) and its size and mtime to the nanosecond: an updated
+    // model doesn't reuse it, even when replaced within the same second, and drops the caches
+    // of its earlier versions
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+    {
+        ERROR_PRINT("Error: unable to stat model file: " + path);
+        return nullptr;
+    }
+#ifdef __APPLE__
+    long mtime_nsec = info.st_mtimespec.tv_nsec;
+#else
+    long mtime_nsec = info.st_mtim.tv_nsec;
+#endif
+    std::string root = config_->mmap_dir();
+    std::string prefix = name + "_" + path_key(path) + "_";
+    std::string cache = prefix + std::to_string(info.st_size) + "_" + std::to_string(info.st_mtime) + "_" +
+                        std::to_string(mtime_nsec);
+    std::string dir = root + "/" + cache;
+    if (!make_dir(root) || !make_dir(dir))
+    {
+        return nullptr;
+    }
+    remove_superseded(root, prefix, cache);
+    runtime_manager_->setExternalPath(dir, MNN::Interpreter::EXTERNAL_WEIGHT_DIR);
+    auto module = MNN::Express::Module::load(inputs, outputs, file->data(), file->size(), runtime_manager_,
+                                             module_config);
+    if (module)
+    {
+        mapped_models_.push_back(file);
+        // weights in the mapped cache are not allocated on the runtime, count the file then
+        size_t after = runtime_memory(runtime_manager_);
+        weights_.emplace_back(name, after > before ? after - before : file->size());
+    }
+    return module;
+}
+
+bool SR::Asr::load()
+{
+    MNN::Express::ExecutorScope scope(executor_);
     Timer timer, timer_total;
     // 检查配置文件中的文件是否存在
     std::vector<std::pair<std::string, std::string>> files_to_check = {
@@ -522,7 +1752,7 @@ void SR::Asr::load()
         {
             ERROR_PRINT("Error: File not found for config '" + config_key + "': " + file_path);
             ERROR_PRINT("Please check if the file exists and has correct permissions.");
-            return;
+            return false;
         }
         file_check.close();
         INFO_PRINT("✓ Found file: " + file_path);
@@ -532,19 +1762,19 @@ void SR::Asr::load()
     if (config_->feats_dims() <= 0)
     {
         ERROR_PRINT("Error: feats_dims not configured properly or is invalid: " + config_->feats_dims());
-        return;
+        return false;
     }
 
     if (config_->chunk_size().empty())
     {
         ERROR_PRINT("Error: chunk_size not configured properly or is empty");
-        return;
+        return false;
     }
 
     if (config_->fsmn_layer() <= 0)
     {
         ERROR_PRINT("Error: fsmn_layer not configured properly or is invalid: " + config_->fsmn_layer());
-        return;
+        return false;
     }
 
     INFO_PRINT("✓ Configuration validation passed");
@@ -559,39 +1789,47 @@ void SR::Asr::load()
     if (!tokenizer_)
     {
         ERROR_PRINT("Error: Failed to create tokenizer from: " + config_->tokenizer_file());
-        return;
+        return false;
     }
     INFO_PRINT("✓ Tokenizer loaded successfully");
 
+    // a runtime set by set_runtime_manager() is shared with other models
+    if (!runtime_manager_)
     {
         MNN::ScheduleConfig config;
         MNN::BackendConfig config_backend;
-        // if (MNN::BackendConfig::isOpenCLAvailable())
-#ifdef USE_GPU
-        config.type = MNN_FORWARD_CUDA;
-        config_backend.power = MNN::BackendConfig::Power_Normal;
-#else
-        config.type = MNN_FORWARD_CPU;
-        config_backend.power = MNN::BackendConfig::Power_Low;
-#endif
-        // config.type = MNN_FORWARD_VULKAN ;
-        config.numThread = 4;
-        config.backendConfig = &config_backend;
+        schedule_config(config, config_backend);
 
         runtime_manager_.reset(MNN::Express::Executor::RuntimeManager::createRuntimeManager(config));
         runtime_manager_->setHint(MNN::Interpreter::MEM_ALLOCATOR_TYPE, 0);
         runtime_manager_->setHint(MNN::Interpreter::DYNAMIC_QUANT_OPTIONS, 1);
+        if (config_->use_mmap())
+        {
+            runtime_manager_->setHint(MNN::Interpreter::USE_CACHED_MMAP, 1);
+        }
     }
 
     modules_.resize(2);
+    weights_.clear();
     MNN::Express::Module::Config module_config;
-    module_config.shapeMutable = true;
+    // static shape models get a fully pre-planned execution for every chunk
+    module_config.shapeMutable = !config_->static_shape();
     module_config.rearrange = true;
 
     std::vector<std::string> encoder_inputs{"speech", "enc_len"};
     std::vector<std::string> encoder_outputs{"alphas", "enc", "enc_len"};
+    if (config_->encoder_stateful())
+    {
+        encoder_outputs.pop_back();
+        for (int i = 0; i < config_->encoder_layers(); i++)
+        {
+            encoder_inputs.emplace_back("in_enc_cache_" + std::to_string(i));
+            encoder_outputs.emplace_back("out_enc_cache_" + std::to_string(i));
+        }
+    }
     std::vector<std::string> decoder_inputs{"enc", "enc_len", "acoustic_embeds", "acoustic_embeds_len"};
-    std::vector<std::string> decoder_outputs{"logits", "sample_ids"};
+    // `logits` is not requested: the decoder already emits argmax ids as `sample_ids`
+    std::vector<std::string> decoder_outputs{"sample_ids"};
 
     for (int i = 0; i < config_->fsmn_layer(); i++)
     {
@@ -602,28 +1840,27 @@ void SR::Asr::load()
 
     // 加载encoder模型
     LOG_PRINT("Loading encoder model from: " + config_->encoder_model());
-    modules_[0].reset(MNN::Express::Module::load(encoder_inputs, encoder_outputs, config_->encoder_model().c_str(),
-                                                 runtime_manager_, &module_config));
+    modules_[0].reset(load_module(encoder_inputs, encoder_outputs, config_->encoder_model(), "encoder", &module_config));
     if (!modules_[0])
     {
         ERROR_PRINT("Error: Failed to load encoder model from: " + config_->encoder_model());
-        return;
+        return false;
     }
     INFO_PRINT("✓ Encoder model loaded successfully");
     DEBUG_PRINT(timer.TimingStr("load encoder model"));
 
     // 加载decoder模型
     std::cout << "Loading decoder model from: " << config_->decoder_model() << std::endl;
-    modules_[1].reset(MNN::Express::Module::load(decoder_inputs, decoder_outputs, config_->decoder_model().c_str(),
-                                                 runtime_manager_, &module_config));
+    modules_[1].reset(load_module(decoder_inputs, decoder_outputs, config_->decoder_model(), "decoder", &module_config));
     if (!modules_[1])
     {
         ERROR_PRINT("Error: Failed to load decoder model from: " + config_->decoder_model());
-        return;
+        return false;
     }
 
     INFO_PRINT("✓ Decoder model loaded successfully");
     INFO_PRINT("✓ All models and components loaded successfully!");
     DEBUG_PRINT(timer.TimingStr("load decoder model"));
     TIMING(timer_total.TimingStr("whole load model"));
+    return true;
 }
@@ -9,6 +9,7 @@
 #define ASR_hpp
 
 #include <vector>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <fstream>
@@ -25,6 +26,10 @@
 
 
 class WavFrontend;
+class Resampler;
+class PcmRing;
+class MappedFile;
+class OpProfiler;
 class OnlineCache;
 
 namespace SR
@@ -32,31 +37,167 @@ namespace SR
 class AsrConfig;
 class Tokenizer;
 
+// bytes held by a model and by one stream on it, parts as {name, bytes}
+struct AsrMemory
+{
+    // resident weights per module (encoder, decoder), shared by every clone
+    std::vector<std::pair<std::string, size_t>> weights;
+    size_t weights_total = 0;
+    // everything allocated on the shared runtime (MNN memory info): the weights plus the
+    // workspace of the loaded instances, clones allocate theirs on their own executor
+    size_t runtime = 0;
+    size_t workspace = 0;
+    // stream state of this instance: overlap feats, fsmn caches, cif state, stateful
+    // encoder caches, their zero states and the ingest ring
+    std::vector<std::pair<std::string, size_t>> session;
+    size_t session_total = 0;
+    // highest session_total after a recognize() chunk, see reset_memory_peak()
+    size_t peak = 0;
+    // what one more stream takes, at least peak: the process growth warmup() measured for
+    // a clone running a chunk (its executor's workspace and stream state). workspace + peak
+    // before a warmup
+    size_t stream = 0;
+};
+
+// an instance is not thread-safe: its modules, executor and stream state belong to one
+// thread at a time. run parallel work on clones, e.g. with AsrPool
 class MNN_PUBLIC Asr {
 public:
     static Asr* createASR(const std::string& config_path);
-    Asr(std::shared_ptr<AsrConfig> config) : config_(config), cache_(nullptr) {}
+    Asr(std::shared_ptr<AsrConfig> config);
     virtual ~Asr();
-    void load();
-    std::string recognize(MNN::Express::VARP speech);
-    void online_recognize(const std::string& wav_file);
-    void offline_recognize(const std::string& wav_file);
+    bool load();
+    // one silent chunk through the frontend, encoder and decoder, so the first stream on a
+    // freshly loaded model doesn't pay for first-run allocation and page faults
+    void warmup();
+    // new instance sharing the loaded weights with its own executor and stream state,
+    // an instance must only be used from one thread at a time, use one clone per thread.
+    // the executor runs thread_num threads: with N clones busy at once, thread_num * N
+    // should not exceed the cores
+    Asr* clone() const;
+    // executor of this instance, create input vars for a clone under its scope
+    std::shared_ptr<MNN::Express::Executor> executor() const { return executor_; }
+    // runtime the models are loaded on; instances whose configs give the same runtime_key()
+    // can share one by setting it before load()
+    std::string runtime_key() const;
+    std::shared_ptr<MNN::Express::Executor::RuntimeManager> runtime_manager() const { return runtime_manager_; }
+    void set_runtime_manager(std::shared_ptr<MNN::Express::Executor::RuntimeManager> runtime)
+    {
+        runtime_manager_ = runtime;
+    }
+    // sample rates a stream may begin with, the chunk size and the resampler scale with it
+    static constexpr int MIN_SAMPLE_RATE = 8000;
+    static constexpr int MAX_SAMPLE_RATE = 192000;
+    // chunk streaming: begin_stream(), then recognize() per chunk with `is_final` on the last one,
+    // chunks at another `sample_rate` than samp_freq are resampled in the stream. 0 is samp_freq,
+    // false for a rate outside MIN_SAMPLE_RATE..MAX_SAMPLE_RATE
+    bool begin_stream(int sample_rate = 0);
+    std::string recognize(MNN::Express::VARP speech, bool is_final = false);
+    // flush the current utterance and reset the stream state in place
+    std::string finalize();
+    // the last recognize() ended an utterance (endpoint_* in config), its text is complete
+    bool is_endpoint() const;
+    // ingestion from another thread: feed() never blocks and returns the samples accepted,
+    // end_stream() is the producer's last call for the stream and the next feed() already
+    // belongs to the next one; the stream thread runs every complete chunk with
+    // recognize_pending(), after the final one (`stream_end`) it goes on with the next
+    // stream at the same rate without touching the ring. end_stream() is false while too
+    // many ended streams are still unread, call it again later
+    size_t feed(const float* pcm, size_t size);
+    bool end_stream();
+    std::string recognize_pending(bool* stream_end = nullptr);
+    // begin a stream whose pcm a local producer process writes into the shared memory ring
+    // `name` (PcmRing::create_shared), chunks are read in place; detached after the final one
+    bool attach_stream(const std::string& name);
+    // a complete chunk or the end of the stream is waiting for recognize_pending()
+    bool stream_ready() const;
+    // wall time of every stage recognize() runs on this instance: resample, fbank, lfr_cmvn,
+    // position_encoding, encoder, cif, decoder, detokenize. MNN evaluates lazily, with a
+    // callback set each stage is computed before the next one starts so the time lands on
+    // the stage that did the work; nullptr turns it off
+    void set_stage_callback(std::function<void(const char* stage, double ms)> callback);
+    // time and flops of every encoder/decoder operator through MNN's op callbacks on this
+    // instance's executor, aggregated over the chunks until disabled. only a clone can be
+    // profiled: the loaded instance runs on the global executor every other load shares,
+    // false there
+    bool set_op_profiling(bool enabled);
+    // op types and layers sorted by time, as a table or json; empty while profiling is off
+    std::string op_profile(int top = 20, bool json = false) const;
+    // memory accounting for admission: another stream fits while runtime and a `stream`
+    // per open stream stay in the budget. call it on the thread running the instance,
+    // e.g. between chunks
+    AsrMemory memory() const;
+    // restart the high-water mark, e.g. per stream
+    void reset_memory_peak() { memory_peak_ = 0; }
+    std::string online_recognize(const std::string& wav_file);
+    std::string online_recognize(MNN::Express::VARP speech, int sample_rate);
+    std::string offline_recognize(const std::string& wav_file);
+    // whole utterances in padded batches, sorted into length buckets to keep padding small,
+    // `sample_rates` per utterance, empty when all of them are at samp_freq
+    std::vector<std::string> offline_recognize(const std::vector<MNN::Express::VARP>& speeches,
+                                               const std::vector<int>& sample_rates = {});
+    // serialize the streaming state with its sample rate and resampler history, a stream can
+    // resume on any process with the same model. restore() begins a stream at that rate,
+    // pcm fed but not yet recognized isn't part of the snapshot
+    std::string snapshot() const;
+    bool restore(const std::string& snapshot);
 private:
+    friend class AsrPipeline;
     void init_cache(int batch_size = 1);
+    // begin a stream at `sample_rate` and recognize one final chunk of silence
+    void silent_chunk(int sample_rate);
+    // fresh stream state at the current rate, the ring is left to the producer
+    void next_stream();
+    int chunk_samples(int sample_rate) const;
+    bool detect_endpoint(MNN::Express::VARP waveforms, const std::string& text);
     MNN::Express::VARP add_overlap_chunk(MNN::Express::VARP feats);
-    MNN::Express::VARP position_encoding(MNN::Express::VARP sample);
+    MNN::Express::VARP position_encoding(MNN::Express::VARP sample, int start_idx);
     MNN::Express::VARPS cif_search(MNN::Express::VARP enc, MNN::Express::VARP alpha);
-    std::string decode(MNN::Express::VARP logits);
+    MNN::Express::VARPS encode(MNN::Express::VARP feats);
+    std::string forward_decoder(MNN::Express::VARP enc, MNN::Express::VARP enc_len,
+                                MNN::Express::VARP acoustic_embeds, int acoustic_embeds_len);
+    std::string decode(const int* token_ptr, int token_num, std::vector<int>* tokens = nullptr);
+    // per chunk stages: overlapped feature windows with their last_chunk flag, then encoder
+    // and cif ({enc, enc_len} plus the fired embeds), then the decoder
+    std::vector<std::pair<MNN::Express::VARP, bool>> frontend_windows(MNN::Express::VARP waveforms, bool is_final);
+    MNN::Express::VARPS encode_window(MNN::Express::VARP feats, bool last_chunk);
+    std::string decode_window(const MNN::Express::VARPS& encoded);
     std::string infer(MNN::Express::VARP feats);
+    void stage_begin();
+    void stage_end(const char* stage, MNN::Express::VARP result = nullptr);
+    MNN::Express::Module* load_module(const std::vector<std::string>& inputs, const std::vector<std::string>& outputs,
+                                      const std::string& path, const std::string& name,
+                                      const MNN::Express::Module::Config* module_config);
+    std::vector<std::string> offline_batch(const std::vector<MNN::Express::VARP>& feats_list);
+    // backend, threads, memory and precision from the config, for the runtime and clones
+    void schedule_config(MNN::ScheduleConfig& config, MNN::BackendConfig& config_backend) const;
+    size_t session_memory(std::vector<std::pair<std::string, size_t>>* parts = nullptr) const;
 private:
     std::shared_ptr<AsrConfig> config_;
     std::shared_ptr<Tokenizer> tokenizer_;
     std::shared_ptr<WavFrontend> frontend_;
+    std::shared_ptr<Resampler> resampler_;
+    std::shared_ptr<PcmRing> ring_;
+    std::vector<float> ring_chunk_;
+    // samp_freq until a stream begins at another rate
+    int stream_rate_ = 0;
     std::shared_ptr<MNN::Express::Executor::RuntimeManager> runtime_manager_;
     std::vector<std::shared_ptr<MNN::Express::Module>> modules_;
+    // resident bytes of every module, measured at load
+    std::vector<std::pair<std::string, size_t>> weights_;
+    size_t memory_peak_ = 0;
+    // per stream memory measured by warmup(), copied to the clones
+    size_t stream_memory_ = 0;
+    // mapped model files with `use_mmap`, shared by the clones
+    std::vector<std::shared_ptr<MappedFile>> mapped_models_;
     std::shared_ptr<OnlineCache> cache_;
+    std::shared_ptr<OnlineCache> zero_cache_;
+    std::shared_ptr<MNN::Express::Executor> executor_;
     int feats_dims_;
     std::vector<int> chunk_size_;
+    std::function<void(const char*, double)> stage_callback_;
+    std::shared_ptr<OpProfiler> op_profiler_;
+    std::chrono::steady_clock::time_point stage_start_;
 };
 }
 
@@ -0,0 +1,249 @@
+//
+//  asr_c.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "mnn_asr.h"
+#include "asr.hpp"
+#include <new>
+#include <cstring>
+#include <algorithm>
+#include "utils/utils.h"
+#include "utils/metrics.h"
+
+struct mnn_asr_model
+{
+    std::shared_ptr<SR::Asr> asr;
+};
+
+struct mnn_asr_session
+{
+    // keeps the weights alive after mnn_asr_model_destroy()
+    std::shared_ptr<SR::Asr> model;
+    std::unique_ptr<SR::Asr> asr;
+    std::string text;
+    bool final = false;
+};
+
+static thread_local std::string last_error;
+
+static Gauge& active_sessions()
+{
+    static Gauge& gauge = Metrics::global().gauge("asr_sessions_active", "Open streaming sessions",
+                                                  "api=\"c\"");
+    return gauge;
+}
+
+static int fail(int status, const std::string& message)
+{
+    last_error = message;
+    ERROR_PRINT("Error: " + message);
+    return status;
+}
+
+// recognizes the complete chunks in the ring, the text waits for mnn_asr_session_poll()
+static void run_pending(mnn_asr_session* session)
+{
+    bool end = false;
+    session->text += session->asr->recognize_pending(&end);
+    session->final = session->final || end;
+}
+
+int mnn_asr_api_version(void)
+{
+    return MNN_ASR_API_VERSION;
+}
+
+const char* mnn_asr_last_error(void)
+{
+    return last_error.c_str();
+}
+
+mnn_asr_model* mnn_asr_model_create(const char* config_path)
+{
+    if (!config_path)
+    {
+        fail(MNN_ASR_INVALID_ARGUMENT, "config path is null");
+        return nullptr;
+    }
+    try
+    {
+        std::unique_ptr<mnn_asr_model> model(new mnn_asr_model);
+        model->asr.reset(SR::Asr::createASR(config_path));
+        if (!model->asr || !model->asr->load())
+        {
+            fail(MNN_ASR_ERROR, std::string("failed to load the models of: ") + config_path);
+            return nullptr;
+        }
+        return model.release();
+    }
+    catch (const std::exception& e)
+    {
+        fail(MNN_ASR_ERROR, e.what());
+        return nullptr;
+    }
+    catch (...)
+    {
+        fail(MNN_ASR_ERROR, "unknown exception");
+        return nullptr;
+    }
+}
+
+void mnn_asr_model_destroy(mnn_asr_model* model)
+{
+    delete model;
+}
+
+mnn_asr_session* mnn_asr_session_create(mnn_asr_model* model, int sample_rate)
+{
+    // 0 is the model's rate
+    if (!model ||
+        (sample_rate && (sample_rate < SR::Asr::MIN_SAMPLE_RATE || sample_rate > SR::Asr::MAX_SAMPLE_RATE)))
+    {
+        fail(MNN_ASR_INVALID_ARGUMENT, "invalid model or sample rate");
+        return nullptr;
+    }
+    try
+    {
+        std::unique_ptr<mnn_asr_session> session(new mnn_asr_session);
+        session->model = model->asr;
+        session->asr.reset(model->asr->clone());
+        if (!session->asr)
+        {
+            fail(MNN_ASR_ERROR, "failed to clone the model");
+            return nullptr;
+        }
+        if (!session->asr->begin_stream(sample_rate))
+        {
+            fail(MNN_ASR_INVALID_ARGUMENT, "unsupported sample rate");
+            return nullptr;
+        }
+        active_sessions().add(1);
+        return session.release();
+    }
+    catch (const std::exception& e)
+    {
+        fail(MNN_ASR_ERROR, e.what());
+        return nullptr;
+    }
+    catch (...)
+    {
+        fail(MNN_ASR_ERROR, "unknown exception");
+        return nullptr;
+    }
+}
+
+void mnn_asr_session_destroy(mnn_asr_session* session)
+{
+    if (session)
+    {
+        active_sessions().add(-1);
+    }
+    delete session;
+}
+
+int mnn_asr_session_feed(mnn_asr_session* session, const float* pcm, size_t samples)
+{
+    if (!session || (!pcm && samples))
+    {
+        return fail(MNN_ASR_INVALID_ARGUMENT, "invalid session or pcm");
+    }
+    try
+    {
+        // more than the ring holds is recognized chunk by chunk in between
+        for (size_t offset = 0; offset < samples;)
+        {
+            size_t accepted = session->asr->feed(pcm + offset, samples - offset);
+            // the last pass left less than a chunk, a full ring is smaller than one chunk
+            if (!accepted)
+            {
+                return fail(MNN_ASR_ERROR, "ingest ring holds less than a chunk, raise ingest_ms");
+            }
+            offset += accepted;
+            run_pending(session);
+        }
+        return MNN_ASR_OK;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(MNN_ASR_ERROR, e.what());
+    }
+    catch (...)
+    {
+        return fail(MNN_ASR_ERROR, "unknown exception");
+    }
+}
+
+int mnn_asr_session_feed_s16(mnn_asr_session* session, const int16_t* pcm, size_t samples)
+{
+    if (!pcm && samples)
+    {
+        return fail(MNN_ASR_INVALID_ARGUMENT, "pcm is null");
+    }
+    float block[4096];
+    for (size_t offset = 0; offset < samples; offset += 4096)
+    {
+        size_t size = std::min<size_t>(4096, samples - offset);
+        for (size_t i = 0; i < size; i++)
+        {
+            block[i] = pcm[offset + i] / 32768.f;
+        }
+        int status = mnn_asr_session_feed(session, block, size);
+        if (status != MNN_ASR_OK)
+        {
+            return status;
+        }
+    }
+    return session ? MNN_ASR_OK : fail(MNN_ASR_INVALID_ARGUMENT, "session is null");
+}
+
+int mnn_asr_session_finish(mnn_asr_session* session)
+{
+    if (!session)
+    {
+        return fail(MNN_ASR_INVALID_ARGUMENT, "session is null");
+    }
+    try
+    {
+        if (!session->asr->end_stream())
+        {
+            return fail(MNN_ASR_ERROR, "too many ended streams unread");
+        }
+        run_pending(session);
+        return MNN_ASR_OK;
+    }
+    catch (const std::exception& e)
+    {
+        return fail(MNN_ASR_ERROR, e.what());
+    }
+    catch (...)
+    {
+        return fail(MNN_ASR_ERROR, "unknown exception");
+    }
+}
+
+int mnn_asr_session_poll(mnn_asr_session* session, char* text, size_t size, int* is_final)
+{
+    if (!session || (!text && size))
+    {
+        return fail(MNN_ASR_INVALID_ARGUMENT, "invalid session or text buffer");
+    }
+    int length = static_cast<int>(session->text.size());
+    if (is_final)
+    {
+        *is_final = 0;
+    }
+    if (session->text.size() >= size)
+    {
+        return length;
+    }
+    ::memcpy(text, session->text.c_str(), session->text.size() + 1);
+    if (is_final)
+    {
+        *is_final = session->final ? 1 : 0;
+    }
+    session->text.clear();
+    session->final = false;
+    return length;
+}
@@ -266,14 +266,41 @@ namespace SR
             return base_dir_ + config_.value("asr_config", "asr_config.json");
         }
 
+        // weight quantized variant, "int8" loads `encoder_int8.mnn` for `encoder.mnn`
+        std::string weight_quant() const
+        {
+            return config_.value("weight_quant", "");
+        }
+
+        std::string model_file(const char* key, const char* default_value) const
+        {
+            std::string name = config_.value(key, default_value);
+            std::string quant = weight_quant();
+            if (!quant.empty() && has_suffix(name, ".mnn"))
+            {
+                name = name.substr(0, name.size() - 4) + "_" + quant + ".mnn";
+            }
+            return base_dir_ + name;
+        }
+
         std::string encoder_model() const
         {
-            return base_dir_ + config_.value("encoder_model", "encoder.mnn");
+            return model_file("encoder_model", "encoder.mnn");
         }
 
         std::string decoder_model() const
         {
-            return base_dir_ + config_.value("decoder_model", "decoder.mnn");
+            return model_file("decoder_model", "decoder.mnn");
+        }
+
+        bool encoder_stateful() const
+        {
+            return config_.value("encoder_stateful", false);
+        }
+
+        bool static_shape() const
+        {
+            return config_.value("static_shape", false);
         }
 
         std::string block_model(int index) const
@@ -314,6 +341,56 @@ namespace SR
             return config_.value("memory", "low");
         }
 
+        // models are read through a read-only mapping and the repacked weights are kept in
+        // mapped files under `mmap_dir`, processes loading the same models share their pages
+        bool use_mmap() const
+        {
+            return config_.value("use_mmap", false);
+        }
+
+        std::string mmap_dir() const
+        {
+            return base_dir_ + config_.value("mmap_dir", "mmap");
+        }
+
+        int batch_size() const
+        {
+            return config_.value("batch_size", 8);
+        }
+
+        float bucket_ratio() const
+        {
+            return config_.value("bucket_ratio", (float)1.25);
+        }
+
+        // endpoint detection, 0 disables a rule
+        int endpoint_silence_ms() const
+        {
+            return config_.value("endpoint_silence_ms", 0);
+        }
+
+        int endpoint_inactive_ms() const
+        {
+            return config_.value("endpoint_inactive_ms", 0);
+        }
+
+        int endpoint_max_ms() const
+        {
+            return config_.value("endpoint_max_ms", 0);
+        }
+
+        // mean square energy below which a chunk counts as silence
+        float endpoint_energy() const
+        {
+            return config_.value("endpoint_energy", (float)1e-5);
+        }
+
+        // pcm the ingestion ring of a stream holds before feed() drops samples
+        int ingest_ms() const
+        {
+            return config_.value("ingest_ms", 10000);
+        }
+
         // backend config end >
 
         // < asr model config start
@@ -322,6 +399,11 @@ namespace SR
             return asr_config_.value("encoder_output_size", 512);
         }
 
+        int encoder_layers() const
+        {
+            return asr_config_.value("encoder_layers", 50);
+        }
+
         int fsmn_layer() const
         {
             return asr_config_.value("fsmn_layer", 16);
@@ -397,6 +479,11 @@ namespace SR
             return asr_config_.value("chunk_size", std::vector<int>{});
         }
 
+        int max_tokens() const
+        {
+            return asr_config_.value("max_tokens", 10);
+        }
+
         std::vector<float> mean() const
         {
             return asr_config_.value("mean", std::vector<float>{});
@@ -0,0 +1,210 @@
+//
+//  asrpipeline.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asrpipeline.hpp"
+#include <MNN/expr/ExecutorScope.hpp>
+#include <algorithm>
+#include "utils/utils.h"
+
+namespace SR
+{
+    // vars don't cross executors, stages hand over plain copies of their outputs
+    struct Frames
+    {
+        std::vector<int> dims;
+        std::vector<float> data;
+    };
+
+    struct AudioItem
+    {
+        std::vector<float> pcm;
+        bool is_final = false;
+    };
+
+    struct WindowItem
+    {
+        Frames feats;
+        bool last_chunk = false;
+        bool chunk_end = false;
+        bool stream_end = false;
+    };
+
+    struct EncodedItem
+    {
+        Frames enc;
+        int enc_len = 0;
+        Frames embeds;
+        bool chunk_end = false;
+        bool stream_end = false;
+    };
+
+    static inline Frames _frames(MNN::Express::VARP var)
+    {
+        auto info = var->getInfo();
+        auto ptr = var->readMap<float>();
+        return {info->dim, std::vector<float>(ptr, ptr + info->size)};
+    }
+
+    static inline MNN::Express::VARP _frames_var(const Frames& frames)
+    {
+        return MNN::Express::_Const(frames.data.data(), frames.dims, MNN::Express::NCHW, halide_type_of<float>());
+    }
+}
+
+SR::AsrPipeline* SR::AsrPipeline::create(const Asr& asr, int sample_rate, int depth)
+{
+    std::unique_ptr<AsrPipeline> pipeline(new AsrPipeline);
+    for (auto& stage : pipeline->stages_)
+    {
+        stage.reset(asr.clone());
+        if (!stage)
+        {
+            return nullptr;
+        }
+        stage->begin_stream(sample_rate);
+    }
+    pipeline->sample_rate_ = sample_rate;
+    pipeline->audio_queue_.reset(new SpscQueue<AudioItem>(depth));
+    // a final chunk may produce two windows
+    pipeline->window_queue_.reset(new SpscQueue<WindowItem>(depth * 2));
+    pipeline->encoded_queue_.reset(new SpscQueue<EncodedItem>(depth * 2));
+    pipeline->text_queue_.reset(new SpscQueue<std::string>(std::max(64, depth * 4)));
+    pipeline->threads_.emplace_back(&AsrPipeline::frontend_loop, pipeline.get());
+    pipeline->threads_.emplace_back(&AsrPipeline::encoder_loop, pipeline.get());
+    pipeline->threads_.emplace_back(&AsrPipeline::decoder_loop, pipeline.get());
+    return pipeline.release();
+}
+
+SR::AsrPipeline::~AsrPipeline()
+{
+    stop_ = true;
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void SR::AsrPipeline::push(MNN::Express::VARP speech, bool is_final)
+{
+    AudioItem item;
+    auto ptr = speech->readMap<float>();
+    item.pcm.assign(ptr, ptr + speech->getInfo()->size);
+    item.is_final = is_final;
+    pushed_++;
+    audio_queue_->push(std::move(item), stop_);
+}
+
+std::string SR::AsrPipeline::poll()
+{
+    std::string text, part;
+    while (text_queue_->try_pop(part))
+    {
+        text += part;
+    }
+    return text;
+}
+
+std::string SR::AsrPipeline::flush()
+{
+    std::string text;
+    while (true)
+    {
+        // texts are queued before a chunk counts as decoded, drain once more after the last one
+        bool done = decoded_ == pushed_;
+        text += poll();
+        if (done)
+        {
+            return text;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void SR::AsrPipeline::frontend_loop()
+{
+    auto& asr = *stages_[0];
+    MNN::Express::ExecutorScope scope(asr.executor());
+    AudioItem audio;
+    while (audio_queue_->pop(audio, stop_))
+    {
+        auto speech = MNN::Express::_Const(audio.pcm.data(), {static_cast<int>(audio.pcm.size())},
+                                           MNN::Express::NHWC, halide_type_of<float>());
+        auto windows = asr.frontend_windows(speech, audio.is_final);
+        for (size_t i = 0; i < windows.size(); i++)
+        {
+            WindowItem item;
+            item.feats = _frames(windows[i].first);
+            item.last_chunk = windows[i].second;
+            item.chunk_end = i + 1 == windows.size();
+            item.stream_end = audio.is_final && item.chunk_end;
+            if (!window_queue_->push(std::move(item), stop_))
+            {
+                return;
+            }
+        }
+        if (audio.is_final)
+        {
+            asr.begin_stream(sample_rate_);
+        }
+    }
+}
+
+void SR::AsrPipeline::encoder_loop()
+{
+    auto& asr = *stages_[1];
+    MNN::Express::ExecutorScope scope(asr.executor());
+    WindowItem window;
+    while (window_queue_->pop(window, stop_))
+    {
+        auto encoded = asr.encode_window(_frames_var(window.feats), window.last_chunk);
+        EncodedItem item;
+        item.enc = _frames(encoded[0]);
+        item.enc_len = encoded[1]->readMap<int>()[0];
+        if (encoded.size() > 2)
+        {
+            item.embeds = _frames(encoded[2]);
+        }
+        item.chunk_end = window.chunk_end;
+        item.stream_end = window.stream_end;
+        if (window.stream_end)
+        {
+            asr.init_cache();
+        }
+        if (!encoded_queue_->push(std::move(item), stop_))
+        {
+            return;
+        }
+    }
+}
+
+void SR::AsrPipeline::decoder_loop()
+{
+    auto& asr = *stages_[2];
+    MNN::Express::ExecutorScope scope(asr.executor());
+    EncodedItem encoded;
+    while (encoded_queue_->pop(encoded, stop_))
+    {
+        std::string text;
+        if (!encoded.embeds.data.empty())
+        {
+            int enc_len = encoded.enc_len;
+            auto enc_len_var = MNN::Express::_Const(&enc_len, {1}, MNN::Express::NCHW, halide_type_of<int>());
+            text = asr.decode_window({_frames_var(encoded.enc), enc_len_var, _frames_var(encoded.embeds)});
+        }
+        if (encoded.stream_end)
+        {
+            asr.init_cache();
+        }
+        if (!text.empty() && !text_queue_->push(std::move(text), stop_))
+        {
+            return;
+        }
+        if (encoded.chunk_end)
+        {
+            decoded_++;
+        }
+    }
+}
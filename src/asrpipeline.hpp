@@ -0,0 +1,57 @@
+//
+//  asrpipeline.hpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#ifndef ASRPIPELINE_hpp
+#define ASRPIPELINE_hpp
+
+#include <atomic>
+#include <thread>
+#include "asr.hpp"
+#include "utils/spsc_queue.h"
+
+namespace SR
+{
+struct AudioItem;
+struct WindowItem;
+struct EncodedItem;
+
+// pipelined streaming of one stream: frontend, encoder + cif and decoder run on three threads
+// connected by bounded lock-free queues, so chunk N+1 is encoded while chunk N is decoded.
+// every stage owns its part of the stream state (feature overlap, encoder/cif caches, decoder
+// fsmn caches) on its own Asr clone, chunks flow through each stage in order.
+// push() and poll()/flush() must be called from one thread; endpointing is not applied.
+class MNN_PUBLIC AsrPipeline {
+public:
+    // `asr` must be loaded, `depth` bounds the chunks queued between two stages
+    static AsrPipeline* create(const Asr& asr, int sample_rate = 0, int depth = 4);
+    virtual ~AsrPipeline();
+    // queue a chunk, only blocks when the frontend is `depth` chunks behind;
+    // the chunk after an `is_final` one starts a new stream
+    void push(MNN::Express::VARP speech, bool is_final = false);
+    // text decoded since the last call, never blocks
+    std::string poll();
+    // block until every pushed chunk is decoded, returns the text not polled yet
+    std::string flush();
+private:
+    AsrPipeline() = default;
+    void frontend_loop();
+    void encoder_loop();
+    void decoder_loop();
+private:
+    std::unique_ptr<Asr> stages_[3];
+    std::unique_ptr<SpscQueue<AudioItem>> audio_queue_;
+    std::unique_ptr<SpscQueue<WindowItem>> window_queue_;
+    std::unique_ptr<SpscQueue<EncodedItem>> encoded_queue_;
+    std::unique_ptr<SpscQueue<std::string>> text_queue_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stop_{false};
+    std::atomic<int64_t> pushed_{0};
+    std::atomic<int64_t> decoded_{0};
+    int sample_rate_ = 0;
+};
+}
+
+#endif // ASRPIPELINE_hpp
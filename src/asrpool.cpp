@@ -0,0 +1,140 @@
+//
+//  asrpool.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asrpool.hpp"
+#include <MNN/expr/ExecutorScope.hpp>
+#include "utils/utils.h"
+#include "utils/metrics.h"
+
+SR::AsrPool* SR::AsrPool::create(const Asr& asr, int workers)
+{
+    std::unique_ptr<AsrPool> pool(new AsrPool);
+    for (int i = 0; i < workers; i++)
+    {
+        pool->workers_.emplace_back(asr.clone());
+        if (!pool->workers_.back())
+        {
+            ERROR_PRINT("Error: failed to clone worker " + std::to_string(i));
+            return nullptr;
+        }
+    }
+    for (auto& worker : pool->workers_)
+    {
+        pool->threads_.emplace_back(&AsrPool::run, pool.get(), worker.get());
+    }
+    return pool.release();
+}
+
+// tasks waiting in every pool of the process
+static Gauge& queue_depth()
+{
+    static Gauge& gauge = Metrics::global().gauge("asr_queue_depth", "Items waiting for a worker", "queue=\"pool\"");
+    return gauge;
+}
+
+SR::AsrPool::~AsrPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void SR::AsrPool::run(Asr* worker)
+{
+    MNN::Express::ExecutorScope scope(worker->executor());
+    while (true)
+    {
+        std::function<void(Asr&)> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+            // pending tasks are drained before the workers exit
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+            running_++;
+            queue_depth().add(-1);
+        }
+        // a throwing task must not take the process down, the recognize tasks forward
+        // their errors to the future themselves
+        try
+        {
+            task(*worker);
+        }
+        catch (const std::exception& e)
+        {
+            ERROR_PRINT(std::string("Error: pool task failed: ") + e.what());
+        }
+        catch (...)
+        {
+            ERROR_PRINT("Error: pool task failed");
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_--;
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+void SR::AsrPool::submit(std::function<void(Asr&)> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+        queue_depth().add(1);
+    }
+    task_cv_.notify_one();
+}
+
+std::future<std::string> SR::AsrPool::online_recognize(const std::string& wav_file)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    submit([promise, wav_file](Asr& asr)
+    {
+        try
+        {
+            promise->set_value(asr.online_recognize(wav_file));
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return promise->get_future();
+}
+
+std::future<std::string> SR::AsrPool::offline_recognize(const std::string& wav_file)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    submit([promise, wav_file](Asr& asr)
+    {
+        try
+        {
+            promise->set_value(asr.offline_recognize(wav_file));
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return promise->get_future();
+}
+
+void SR::AsrPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return tasks_.empty() && running_ == 0; });
+}
@@ -0,0 +1,51 @@
+//
+//  asrpool.hpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#ifndef ASRPOOL_hpp
+#define ASRPOOL_hpp
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <condition_variable>
+#include "asr.hpp"
+
+namespace SR
+{
+// worker threads each owning an Asr clone: the encoder/decoder weights of the loaded model
+// are shared, every worker has its own modules, executor and stream state, so tasks run
+// in parallel on one copy of the weights. the pool itself is thread-safe.
+class MNN_PUBLIC AsrPool {
+public:
+    // `asr` must be loaded, returns nullptr when a clone fails
+    static AsrPool* create(const Asr& asr, int workers);
+    virtual ~AsrPool();
+    int size() const { return static_cast<int>(workers_.size()); }
+    // run `task` on the next free worker, with that worker's executor in scope; an exception
+    // escaping `task` is logged, the worker goes on with the next task
+    void submit(std::function<void(Asr&)> task);
+    // the future rethrows an exception of the recognition from get()
+    std::future<std::string> online_recognize(const std::string& wav_file);
+    std::future<std::string> offline_recognize(const std::string& wav_file);
+    // block until every submitted task has finished
+    void wait();
+private:
+    AsrPool() = default;
+    void run(Asr* worker);
+private:
+    std::vector<std::unique_ptr<Asr>> workers_;
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void(Asr&)>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable task_cv_;
+    std::condition_variable idle_cv_;
+    int running_ = 0;
+    bool stop_ = false;
+};
+}
+
+#endif // ASRPOOL_hpp
@@ -0,0 +1,171 @@
+//
+//  asrregistry.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asrregistry.hpp"
+#include "utils/utils.h"
+
+std::shared_ptr<SR::Asr> SR::AsrRegistry::acquire(const std::string& config_path)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        if (it->config_path == config_path)
+        {
+            entries_.splice(entries_.begin(), entries_, it);
+            auto model = it->model;
+            lock.unlock();
+            // waits while another thread is loading it
+            return model.get();
+        }
+    }
+    std::promise<std::shared_ptr<Asr>> promise;
+    Entry entry;
+    entry.config_path = config_path;
+    entry.model = promise.get_future().share();
+    entries_.push_front(entry);
+    lock.unlock();
+
+    size_t memory = 0;
+    std::shared_ptr<Asr> model;
+    {
+        std::lock_guard<std::mutex> load_lock(load_mutex_);
+        model = load(config_path, memory);
+    }
+    promise.set_value(model);
+
+    lock.lock();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        // unless a reload() replaced it meanwhile
+        if (it->config_path == config_path && it->model.get() == model)
+        {
+            if (!model)
+            {
+                // the next acquire() tries again
+                entries_.erase(it);
+                return nullptr;
+            }
+            it->memory = memory;
+            memory_ += memory;
+            break;
+        }
+    }
+    trim_locked();
+    return model;
+}
+
+bool SR::AsrRegistry::reload(const std::string& config_path)
+{
+    size_t memory = 0;
+    std::shared_ptr<Asr> model;
+    {
+        std::lock_guard<std::mutex> load_lock(load_mutex_);
+        model = load(config_path, memory);
+        if (!model)
+        {
+            return false;
+        }
+        model->warmup();
+    }
+    std::promise<std::shared_ptr<Asr>> promise;
+    promise.set_value(model);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.begin();
+    while (it != entries_.end() && it->config_path != config_path)
+    {
+        ++it;
+    }
+    if (it == entries_.end())
+    {
+        entries_.push_front(Entry());
+        it = entries_.begin();
+        it->config_path = config_path;
+    }
+    else
+    {
+        // the old model leaves the accounting, it is freed with its last holder
+        memory_ -= it->memory;
+        entries_.splice(entries_.begin(), entries_, it);
+    }
+    it->model = promise.get_future().share();
+    it->memory = memory;
+    memory_ += memory;
+    INFO_PRINT("✓ Registry reloaded " + config_path);
+    trim_locked();
+    return true;
+}
+
+// with load_mutex_ held: MNN doesn't build modules in parallel on one executor or runtime,
+// and the weight growth measured per module must be this model's alone
+std::shared_ptr<SR::Asr> SR::AsrRegistry::load(const std::string& config_path, size_t& memory)
+{
+    std::shared_ptr<Asr> asr(Asr::createASR(config_path));
+    std::string key = asr->runtime_key();
+    std::shared_ptr<MNN::Express::Executor::RuntimeManager> runtime;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        runtime = runtimes_[key].lock();
+    }
+    if (runtime)
+    {
+        asr->set_runtime_manager(runtime);
+    }
+    if (!asr->load())
+    {
+        ERROR_PRINT("Error: failed to load model: " + config_path);
+        return nullptr;
+    }
+    memory = asr->memory().weights_total;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!runtimes_[key].lock())
+        {
+            runtimes_[key] = asr->runtime_manager();
+        }
+    }
+    INFO_PRINT("✓ Registry loaded " + config_path + ": " + std::to_string(memory / (1024 * 1024)) + "MB");
+    return asr;
+}
+
+void SR::AsrRegistry::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    trim_locked();
+}
+
+void SR::AsrRegistry::trim_locked()
+{
+    // least recently used first, loading and in use models stay
+    for (auto it = entries_.end(); budget_ > 0 && memory_ > budget_ && it != entries_.begin();)
+    {
+        --it;
+        if (it->model.wait_for(std::chrono::seconds(0)) != std::future_status::ready ||
+            it->model.get().use_count() > 1)
+        {
+            continue;
+        }
+        INFO_PRINT("Registry unloads idle model: " + it->config_path);
+        memory_ -= it->memory;
+        it = entries_.erase(it);
+    }
+    if (budget_ > 0 && memory_ > budget_)
+    {
+        WARNING_PRINT("Warning: models in use exceed the memory budget: " + std::to_string(memory_ / (1024 * 1024)) +
+                    "MB");
+    }
+}
+
+size_t SR::AsrRegistry::memory() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_;
+}
+
+size_t SR::AsrRegistry::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
@@ -0,0 +1,61 @@
+//
+//  asrregistry.hpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#ifndef ASRREGISTRY_hpp
+#define ASRREGISTRY_hpp
+
+#include <list>
+#include <mutex>
+#include <future>
+#include "asr.hpp"
+
+namespace SR
+{
+// loaded models keyed by config path: a model is loaded on its first acquire(), models
+// with the same runtime_key() share one RuntimeManager, and when the resident memory of
+// the loaded models exceeds the budget the least recently used idle ones are unloaded.
+// a model is idle when only the registry holds it, sessions keep the returned pointer
+// (and their clones of it) alive. the registry is thread-safe, a slow load doesn't block
+// acquiring models that are already loaded. loads run one at a time: they all build on the
+// global executor and may share a runtime (and its external weight path).
+class MNN_PUBLIC AsrRegistry {
+public:
+    // `budget` in bytes, 0 for no limit
+    explicit AsrRegistry(size_t budget = 0) : budget_(budget) {}
+    virtual ~AsrRegistry() = default;
+    // the loaded model of `config_path`, nullptr when loading fails
+    std::shared_ptr<Asr> acquire(const std::string& config_path);
+    // load `config_path` again (e.g. after a deploy replaced its files) and warm it up on
+    // the calling thread, then later acquire() calls get the new model. holders of the old
+    // one keep using it until they drop it. false when the new model fails to load, the old
+    // one is kept then
+    bool reload(const std::string& config_path);
+    // unload idle models until the budget is met
+    void trim();
+    size_t memory() const;
+    size_t size() const;
+private:
+    struct Entry
+    {
+        std::string config_path;
+        std::shared_future<std::shared_ptr<Asr>> model;
+        size_t memory = 0;
+    };
+    std::shared_ptr<Asr> load(const std::string& config_path, size_t& memory);
+    void trim_locked();
+private:
+    size_t budget_;
+    size_t memory_ = 0;
+    // most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::weak_ptr<MNN::Express::Executor::RuntimeManager>> runtimes_;
+    mutable std::mutex mutex_;
+    // held for a whole load (and the warmup of a reload), taken before mutex_, never while holding it
+    std::mutex load_mutex_;
+};
+}
+
+#endif // ASRREGISTRY_hpp
@@ -0,0 +1,78 @@
+/*
+ *  mnn_asr.h
+ *
+ *  Created by smart on 2026/10/18.
+ *
+ *  Stable C API of libmnnasr. Handles are opaque, functions never throw and return
+ *  MNN_ASR_OK or a negative status, mnn_asr_last_error() tells what went wrong on the
+ *  calling thread. New functions may be added, existing signatures don't change within
+ *  an MNN_ASR_API_VERSION.
+ */
+
+#ifndef MNN_ASR_H
+#define MNN_ASR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* define MNN_ASR_STATIC when linking the static library, MNN_ASR_BUILD is set building the dll */
+#if defined(_WIN32) && defined(MNN_ASR_STATIC)
+#define MNN_ASR_API
+#elif defined(_WIN32) && defined(MNN_ASR_BUILD)
+#define MNN_ASR_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define MNN_ASR_API __declspec(dllimport)
+#else
+#define MNN_ASR_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MNN_ASR_API_VERSION 1
+
+enum
+{
+    MNN_ASR_OK = 0,
+    MNN_ASR_ERROR = -1,
+    MNN_ASR_INVALID_ARGUMENT = -2
+};
+
+/* loaded model weights, shared by all sessions created from it */
+typedef struct mnn_asr_model mnn_asr_model;
+/* one audio stream; a session is used by one thread at a time, sessions run in parallel */
+typedef struct mnn_asr_session mnn_asr_session;
+
+MNN_ASR_API int mnn_asr_api_version(void);
+MNN_ASR_API const char* mnn_asr_last_error(void);
+
+/* config.json written by the export script, NULL on failure */
+MNN_ASR_API mnn_asr_model* mnn_asr_model_create(const char* config_path);
+/* sessions keep the weights alive, the model may be destroyed before them */
+MNN_ASR_API void mnn_asr_model_destroy(mnn_asr_model* model);
+
+/* pcm at `sample_rate` (8000..192000), 0 for the model's rate; other rates are resampled,
+ * NULL with MNN_ASR_INVALID_ARGUMENT outside that range */
+MNN_ASR_API mnn_asr_session* mnn_asr_session_create(mnn_asr_model* model, int sample_rate);
+MNN_ASR_API void mnn_asr_session_destroy(mnn_asr_session* session);
+
+/* samples in [-1, 1] or 16 bit pcm; complete chunks are recognized on the calling thread */
+MNN_ASR_API int mnn_asr_session_feed(mnn_asr_session* session, const float* pcm, size_t samples);
+MNN_ASR_API int mnn_asr_session_feed_s16(mnn_asr_session* session, const int16_t* pcm, size_t samples);
+/* end of the stream: the rest is recognized, the next feed starts a new stream */
+MNN_ASR_API int mnn_asr_session_finish(mnn_asr_session* session);
+
+/*
+ * text decoded since the last poll, copied NUL terminated into `text` and removed from the
+ * session. returns its length in bytes; when `size` is too small nothing is copied and the
+ * returned length tells the size needed (minus the NUL). `is_final` (optional) is set to 1
+ * when the returned text ends a stream.
+ */
+MNN_ASR_API int mnn_asr_session_poll(mnn_asr_session* session, char* text, size_t size, int* is_final);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MNN_ASR_H */
@@ -0,0 +1,157 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#include "resampler.h"
+#include <cmath>
+#include <algorithm>
+#include <MNN/expr/ExprCreator.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static inline float dot_product(const float* a, const float* b, int size)
+{
+    int i = 0;
+    float sum = 0.f;
+#if defined(__AVX__)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= size; i += 8)
+    {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m128 acc4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    acc4 = _mm_add_ps(acc4, _mm_movehl_ps(acc4, acc4));
+    acc4 = _mm_add_ss(acc4, _mm_shuffle_ps(acc4, acc4, 1));
+    sum = _mm_cvtss_f32(acc4);
+#elif defined(__SSE__) || defined(_M_X64)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= size; i += 4)
+    {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#elif defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (; i + 4 <= size; i += 4)
+    {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    float32x2_t acc2 = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(acc2, acc2), 0);
+#endif
+    for (; i < size; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// zeroth order modified bessel function of the first kind, for the kaiser window
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static int gcd(int a, int b)
+{
+    return b == 0 ? a : gcd(b, a % b);
+}
+
+Resampler::Resampler(int in_rate, int out_rate, float rolloff) : in_rate_(in_rate), out_rate_(out_rate)
+{
+    int g = gcd(in_rate, out_rate);
+    up_ = out_rate / g;
+    down_ = in_rate / g;
+    // longer filters when decimating, the cutoff follows the lower nyquist
+    double ratio = std::max(1.0, static_cast<double>(down_) / up_);
+    taps_ = (static_cast<int>(std::ceil(16 * ratio)) + 7) / 8 * 8;
+    double cutoff = 0.5 * rolloff / (up_ * ratio);
+    constexpr double beta = 8.0;
+    int length = taps_ * up_;
+    double center = (length - 1) / 2.0;
+    coeffs_.resize(length);
+    for (int p = 0; p < up_; p++)
+    {
+        for (int k = 0; k < taps_; k++)
+        {
+            // coefficient for buffer offset k of phase p is h[p + (taps - 1 - k) * up]
+            int j = p + (taps_ - 1 - k) * up_;
+            double x = j - center;
+            double sinc = x == 0 ? 2 * cutoff : std::sin(2 * M_PI * cutoff * x) / (M_PI * x);
+            double r = x / center;
+            double window = bessel_i0(beta * std::sqrt(std::max(0.0, 1 - r * r))) / bessel_i0(beta);
+            coeffs_[p * taps_ + k] = static_cast<float>(sinc * window * up_);
+        }
+    }
+    reset();
+}
+
+void Resampler::reset()
+{
+    buffer_.assign(taps_ - 1, 0.f);
+    position_ = 0;
+}
+
+bool Resampler::restore(const std::vector<float>& history, int64_t position)
+{
+    // process() leaves at least the history of a window and an output position inside it
+    if (history.size() < static_cast<size_t>(taps_ - 1) || position < 0 ||
+        position / up_ > static_cast<int64_t>(history.size()))
+    {
+        return false;
+    }
+    buffer_ = history;
+    position_ = position;
+    return true;
+}
+
+void Resampler::process(const float* input, size_t size, std::vector<float>& output)
+{
+    buffer_.insert(buffer_.end(), input, input + size);
+    int64_t available = static_cast<int64_t>(buffer_.size()) - taps_;
+    while (position_ / up_ <= available)
+    {
+        int64_t start = position_ / up_;
+        int phase = static_cast<int>(position_ % up_);
+        output.push_back(dot_product(buffer_.data() + start, coeffs_.data() + phase * taps_, taps_));
+        position_ += down_;
+    }
+    // drop the consumed input, keep the history of the next window
+    int64_t consumed = std::min<int64_t>(position_ / up_, buffer_.size());
+    buffer_.erase(buffer_.begin(), buffer_.begin() + consumed);
+    position_ -= consumed * up_;
+}
+
+void Resampler::flush(std::vector<float>& output)
+{
+    // the linear phase filter delays the output by half a window
+    std::vector<float> zeros(taps_ / 2, 0.f);
+    process(zeros.data(), zeros.size(), output);
+}
+
+MNN::Express::VARP Resampler::process(MNN::Express::VARP waveforms, bool flush)
+{
+    std::vector<float> output;
+    output.reserve((static_cast<size_t>(waveforms->getInfo()->size) + taps_) * up_ / down_ + 1);
+    process(waveforms->readMap<float>(), waveforms->getInfo()->size, output);
+    if (flush)
+    {
+        this->flush(output);
+    }
+    return MNN::Express::_Const(output.data(), {static_cast<int>(output.size())}, MNN::Express::NHWC,
+                                halide_type_of<float>());
+}
@@ -0,0 +1,49 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <vector>
+#include <MNN/expr/Expr.hpp>
+
+// streaming polyphase resampler with a kaiser windowed sinc filter, the filter history
+// is kept across calls so chunks of one stream can be fed one by one
+class Resampler
+{
+public:
+    Resampler(int in_rate, int out_rate, float rolloff = 0.95f);
+    ~Resampler() = default;
+    // `flush` pushes the filter delay out after the last chunk of a stream
+    MNN::Express::VARP process(MNN::Express::VARP waveforms, bool flush = false);
+    void process(const float* input, size_t size, std::vector<float>& output);
+    void flush(std::vector<float>& output);
+    void reset();
+    int in_rate() const { return in_rate_; }
+    int out_rate() const { return out_rate_; }
+    // carried over input and the next output position, a stream moving to another
+    // resampler at the same rates continues from them
+    const std::vector<float>& history() const { return buffer_; }
+    int64_t position() const { return position_; }
+    // false when the state can't come from this filter
+    bool restore(const std::vector<float>& history, int64_t position);
+
+private:
+    int in_rate_;
+    int out_rate_;
+    // out_rate / in_rate = up_ / down_
+    int up_;
+    int down_;
+    // taps per phase, a multiple of 8 for the simd dot product
+    int taps_;
+    // [up_, taps_] reversed phase filters
+    std::vector<float> coeffs_;
+    // taps_ - 1 samples of history followed by pending input
+    std::vector<float> buffer_;
+    // position of the next output in the upsampled domain, relative to buffer_
+    int64_t position_ = 0;
+};
+
+
+#endif //RESAMPLER_H
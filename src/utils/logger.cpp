@@ -0,0 +1,316 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#include "logger.h"
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstdint>
+#include <condition_variable>
+#include <new>
+#include <pthread.h>
+
+std::atomic<int> Logger::level_(Logger::TRACE);
+
+namespace
+{
+const char* const MODULE_NAME = "SpeechReconstruction";
+
+struct LogRecord
+{
+    std::atomic<LogRecord*> next{nullptr};
+    int level = 0;
+    const char* location = nullptr;
+    const char* function = nullptr;
+    std::string message;
+};
+
+// unbounded multi-producer single-consumer queue: a producer swaps itself in as the head
+// with one exchange, the consumer follows the links from a stub record
+class LogQueue
+{
+public:
+    LogQueue() : head_(new LogRecord), tail_(head_.load()) {}
+
+    void push(LogRecord* record)
+    {
+        LogRecord* prev = head_.exchange(record, std::memory_order_acq_rel);
+        prev->next.store(record, std::memory_order_release);
+    }
+
+    // false when empty or while a producer is between its exchange and its link
+    bool pop(LogRecord& out)
+    {
+        LogRecord* next = tail_->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+        // `next` becomes the stub once its payload is taken
+        out.level = next->level;
+        out.location = next->location;
+        out.function = next->function;
+        out.message.swap(next->message);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+private:
+    std::atomic<LogRecord*> head_;
+    LogRecord* tail_;
+};
+
+void format(std::string& out, const LogRecord& record)
+{
+    static const char* const prefix[] = {"\033[31m[ERROR] ", "\033[33m[WARNING] ", "\033[32m[INFO] ",
+                                         "[LOG] ", "\033[34m[DEBUG] ", "\033[35m[TRACE] "};
+    bool color = record.level != Logger::LOG;
+    out += record.level >= Logger::ERROR && record.level <= Logger::TRACE ? prefix[record.level] : "";
+    if (record.location)
+    {
+        out += "[";
+        out += MODULE_NAME;
+        out += "] [";
+        out += record.location;
+        out += "] ";
+    }
+    if (record.function)
+    {
+        out += "[";
+        out += record.function;
+        out += "] ";
+    }
+    out += record.message;
+    out += color ? "\033[0m\n" : "\n";
+}
+
+class LogWriter
+{
+public:
+    LogWriter() : thread_(&LogWriter::run, this) {}
+
+    void push(LogRecord* record)
+    {
+        queue_.push(record);
+        pushed_.fetch_add(1);
+        if (stopped_.load(std::memory_order_acquire))
+        {
+            drain();
+        }
+        else if (sleeping_.load())
+        {
+            wake_.notify_one();
+        }
+    }
+
+    void flush()
+    {
+        uint64_t target = pushed_.load(std::memory_order_acquire);
+        if (stopped_.load(std::memory_order_acquire))
+        {
+            drain();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.notify_one();
+        // bounded, an error never hangs the caller on a writer that stopped making progress
+        written_cv_.wait_for(lock, std::chrono::seconds(1), [&]()
+        {
+            return written_.load(std::memory_order_acquire) >= target || stopped_.load(std::memory_order_acquire);
+        });
+    }
+
+    // at exit: write what is queued, later messages are written on the logging thread
+    void stop()
+    {
+        if (stopped_.load(std::memory_order_acquire))
+        {
+            drain();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        thread_.join();
+        stopped_.store(true, std::memory_order_release);
+        written_cv_.notify_all();
+        drain();
+    }
+    // fork() copies only the calling thread: the locks are held across it so the child gets
+    // them unlocked, and the child writes on the logging thread as the writer thread is gone.
+    // records queued before the fork are the parent's to write
+    void before_fork()
+    {
+        drain_mutex_.lock();
+        mutex_.lock();
+    }
+
+    void after_fork_parent()
+    {
+        mutex_.unlock();
+        drain_mutex_.unlock();
+    }
+
+    void after_fork_child()
+    {
+        // the copied records leak, a producer may have been between its exchange and its link
+        new (&queue_) LogQueue;
+        pushed_.store(0);
+        written_.store(0);
+        sleeping_.store(false);
+        stopped_.store(true, std::memory_order_release);
+        mutex_.unlock();
+        drain_mutex_.unlock();
+    }
+private:
+    size_t drain()
+    {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        std::string out;
+        size_t count = 0;
+        LogRecord record;
+        while (queue_.pop(record))
+        {
+            format(out, record);
+            count++;
+        }
+        if (count)
+        {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+            written_.fetch_add(count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            if (drain())
+            {
+                // flush() waits under the mutex, take it so the notify is not lost
+                std::lock_guard<std::mutex> lock(mutex_);
+                written_cv_.notify_all();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stop_)
+            {
+                break;
+            }
+            // producers notify without the lock, the timeout bounds a missed wakeup
+            sleeping_.store(true);
+            if (pushed_.load() == written_.load())
+            {
+                wake_.wait_for(lock, std::chrono::milliseconds(50));
+            }
+            sleeping_.store(false);
+        }
+    }
+
+    LogQueue queue_;
+    std::mutex drain_mutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable written_cv_;
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stopped_{false};
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+LogWriter& writer();
+
+void stop_at_exit()
+{
+    writer().stop();
+}
+
+void before_fork()
+{
+    writer().before_fork();
+}
+
+void after_fork_parent()
+{
+    writer().after_fork_parent();
+}
+
+void after_fork_child()
+{
+    writer().after_fork_child();
+}
+
+// never destroyed, static destructors may still log after the exit handler ran
+LogWriter& writer()
+{
+    static LogWriter* instance = []()
+    {
+        auto writer = new LogWriter;
+        std::atexit(stop_at_exit);
+        // prefork servers log in the parent before forking workers
+        pthread_atfork(before_fork, after_fork_parent, after_fork_child);
+        return writer;
+    }();
+    return *instance;
+}
+
+int level_from_env()
+{
+    const char* value = std::getenv("ASR_LOG_LEVEL");
+    if (!value || !*value)
+    {
+        return Logger::TRACE;
+    }
+    static const char* const names[] = {"error", "warning", "info", "log", "debug", "trace"};
+    for (int i = 0; i <= Logger::TRACE; i++)
+    {
+        size_t n = 0;
+        while (names[i][n] && std::tolower(static_cast<unsigned char>(value[n])) == names[i][n])
+        {
+            n++;
+        }
+        if (!names[i][n] && !value[n])
+        {
+            return i;
+        }
+    }
+    return std::atoi(value);
+}
+
+struct LevelFromEnv
+{
+    LevelFromEnv()
+    {
+        Logger::set_level(level_from_env());
+    }
+} level_from_env_;
+}
+
+void Logger::write(int level, const char* location, const char* function, std::string&& message)
+{
+    auto record = new LogRecord;
+    record->level = level;
+    record->location = location;
+    record->function = function;
+    record->message = std::move(message);
+    writer().push(record);
+    if (level == ERROR)
+    {
+        writer().flush();
+    }
+}
+
+void Logger::flush()
+{
+    writer().flush();
+}
@@ -0,0 +1,90 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <cstddef>
+
+// asynchronous logger: a call site checks the level before anything is formatted, the
+// message is moved into a lock-free queue and a background thread writes it to stdout,
+// so an inference thread never blocks on the terminal. errors are written before the
+// call returns. ASR_LOG_LEVEL=error|warning|info|log|debug|trace (or 0-5) in the
+// environment sets the level at startup, Logger::set_level() at runtime
+class Logger
+{
+public:
+    enum Level { ERROR, WARNING, INFO, LOG, DEBUG, TRACE };
+
+    static bool enabled(int level)
+    {
+        return level <= level_.load(std::memory_order_relaxed);
+    }
+    static void set_level(int level)
+    {
+        level_.store(level, std::memory_order_relaxed);
+    }
+    static int level()
+    {
+        return level_.load(std::memory_order_relaxed);
+    }
+    // `location` and `function` are string literals
+    static void write(int level, const char* location, const char* function, std::string&& message);
+    // block until every message logged before the call is written
+    static void flush();
+private:
+    static std::atomic<int> level_;
+};
+
+class LogStream {
+public:
+    enum LogLevel { ERROR = Logger::ERROR, WARNING = Logger::WARNING, INFO = Logger::INFO,
+                    LOG = Logger::LOG, DEBUG = Logger::DEBUG, TRACE = Logger::TRACE };
+
+    LogStream(LogLevel level, const char* location = nullptr, const char* function = nullptr)
+        : level_(level), location_(location), function_(function) {}
+
+    template<typename T>
+    LogStream& operator<<(const T& value) {
+        stream_ << value;
+        return *this;
+    }
+
+    ~LogStream() {
+        Logger::write(level_, location_, function_, stream_.str());
+    }
+
+private:
+    LogLevel level_;
+    const char* location_;
+    const char* function_;
+    std::ostringstream stream_;
+};
+
+// offset of the path from `src` (or of the file name for sources outside of it), evaluated
+// by the compiler so the log location is a string literal
+namespace logger_detail
+{
+    constexpr size_t find_src(const char* path, size_t i)
+    {
+        return path[i] == '\0' ? static_cast<size_t>(-1)
+             : (path[i] == 's' && path[i + 1] == 'r' && path[i + 2] == 'c') ? i
+             : find_src(path, i + 1);
+    }
+
+    constexpr size_t file_name(const char* path, size_t i, size_t last)
+    {
+        return path[i] == '\0' ? last : file_name(path, i + 1, (path[i] == '/' || path[i] == '\\') ? i + 1 : last);
+    }
+
+    constexpr size_t source_offset(const char* path)
+    {
+        return find_src(path, 0) != static_cast<size_t>(-1) ? find_src(path, 0) : file_name(path, 0, 0);
+    }
+}
+
+#endif // LOGGER_H
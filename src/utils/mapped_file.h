@@ -0,0 +1,62 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// read-only mapping of a whole file, its pages live in the page cache and are shared by
+// every process mapping the same file instead of being read into private memory
+class MappedFile
+{
+public:
+    static MappedFile* open(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        void* ptr = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        // the model is parsed front to back right after mapping
+        ::madvise(ptr, info.st_size, MADV_WILLNEED);
+        return new MappedFile(ptr, info.st_size);
+    }
+
+    ~MappedFile()
+    {
+        ::munmap(data_, size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(data_); }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile(void* data, size_t size) : data_(data), size_(size) {}
+
+    void* data_;
+    size_t size_;
+};
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,205 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#include "metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+Metrics& Metrics::global()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::~Metrics()
+{
+    stop_writer();
+}
+
+Metrics::Entry* Metrics::find(Type type, const std::string& name, const std::string& labels)
+{
+    for (auto& entry : entries_)
+    {
+        if (entry->type == type && entry->name == name && entry->labels == labels)
+        {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = find(COUNTER, name, labels);
+    if (!entry)
+    {
+        entries_.emplace_back(new Entry{COUNTER, name, help, labels, nullptr, nullptr, nullptr});
+        entry = entries_.back().get();
+        entry->counter.reset(new Counter);
+    }
+    return *entry->counter;
+}
+
+Gauge& Metrics::gauge(const std::string& name, const std::string& help, const std::string& labels)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = find(GAUGE, name, labels);
+    if (!entry)
+    {
+        entries_.emplace_back(new Entry{GAUGE, name, help, labels, nullptr, nullptr, nullptr});
+        entry = entries_.back().get();
+        entry->gauge.reset(new Gauge);
+    }
+    return *entry->gauge;
+}
+
+Histogram& Metrics::histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds,
+                              const std::string& labels)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = find(HISTOGRAM, name, labels);
+    if (!entry)
+    {
+        entries_.emplace_back(new Entry{HISTOGRAM, name, help, labels, nullptr, nullptr, nullptr});
+        entry = entries_.back().get();
+        entry->histogram.reset(new Histogram(bounds));
+    }
+    return *entry->histogram;
+}
+
+void Metrics::on_collect(std::function<void()> collect)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    collects_.push_back(collect);
+}
+
+static std::string label_set(const std::string& labels, const std::string& extra = "")
+{
+    if (labels.empty() && extra.empty())
+    {
+        return "";
+    }
+    return "{" + labels + (labels.empty() || extra.empty() ? "" : ",") + extra + "}";
+}
+
+std::string Metrics::prometheus()
+{
+    std::vector<std::function<void()>> collects;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collects = collects_;
+    }
+    for (auto& collect : collects)
+    {
+        collect();
+    }
+    static const char* TYPES[] = {"counter", "gauge", "histogram"};
+    std::ostringstream text;
+    text.precision(10);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<bool> written(entries_.size(), false);
+    // one HELP/TYPE header per family, its label sets below it
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        if (written[i])
+        {
+            continue;
+        }
+        const auto& family = *entries_[i];
+        text << "# HELP " << family.name << " " << family.help << "\n";
+        text << "# TYPE " << family.name << " " << TYPES[family.type] << "\n";
+        for (size_t j = i; j < entries_.size(); j++)
+        {
+            const auto& entry = *entries_[j];
+            if (written[j] || entry.name != family.name)
+            {
+                continue;
+            }
+            written[j] = true;
+            if (entry.type == COUNTER)
+            {
+                text << entry.name << label_set(entry.labels) << " " << entry.counter->value() << "\n";
+            }
+            else if (entry.type == GAUGE)
+            {
+                text << entry.name << label_set(entry.labels) << " " << entry.gauge->value() << "\n";
+            }
+            else
+            {
+                const auto& histogram = *entry.histogram;
+                uint64_t total = 0;
+                for (size_t b = 0; b <= histogram.bounds().size(); b++)
+                {
+                    total += histogram.count(b);
+                    std::ostringstream bound;
+                    bound.precision(10);
+                    if (b < histogram.bounds().size())
+                    {
+                        bound << histogram.bounds()[b];
+                    }
+                    else
+                    {
+                        bound << "+Inf";
+                    }
+                    text << entry.name << "_bucket" << label_set(entry.labels, "le=\"" + bound.str() + "\"") << " "
+                         << total << "\n";
+                }
+                text << entry.name << "_sum" << label_set(entry.labels) << " " << histogram.sum() << "\n";
+                text << entry.name << "_count" << label_set(entry.labels) << " " << total << "\n";
+            }
+        }
+    }
+    return text.str();
+}
+
+bool Metrics::write(const std::string& path)
+{
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file << prometheus();
+        if (!file.good())
+        {
+            return false;
+        }
+    }
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+void Metrics::start_writer(const std::string& path, int interval_ms)
+{
+    stop_writer();
+    writer_stop_ = false;
+    writer_ = std::thread([this, path, interval_ms]()
+    {
+        std::unique_lock<std::mutex> lock(writer_mutex_);
+        while (!writer_stop_)
+        {
+            lock.unlock();
+            write(path);
+            lock.lock();
+            writer_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms), [this]() { return writer_stop_; });
+        }
+    });
+}
+
+void Metrics::stop_writer()
+{
+    if (!writer_.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex_);
+        writer_stop_ = true;
+    }
+    writer_cv_.notify_all();
+    writer_.join();
+}
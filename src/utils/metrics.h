@@ -0,0 +1,120 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// double with an atomic add, std::atomic<double> of c++11 has no fetch_add
+class AtomicDouble
+{
+public:
+    void add(double value)
+    {
+        double current = value_.load(std::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+        {
+        }
+    }
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    double get() const { return value_.load(std::memory_order_relaxed); }
+private:
+    std::atomic<double> value_{0.0};
+};
+
+class Counter
+{
+public:
+    void add(double value = 1) { value_.add(value); }
+    double value() const { return value_.get(); }
+private:
+    AtomicDouble value_;
+};
+
+class Gauge
+{
+public:
+    void set(double value) { value_.set(value); }
+    void add(double value) { value_.add(value); }
+    double value() const { return value_.get(); }
+private:
+    AtomicDouble value_;
+};
+
+// cumulative buckets of prometheus, upper bounds ascending
+class Histogram
+{
+public:
+    explicit Histogram(const std::vector<double>& bounds) : bounds_(bounds), counts_(bounds.size() + 1) {}
+    void observe(double value)
+    {
+        size_t i = 0;
+        while (i < bounds_.size() && value > bounds_[i])
+        {
+            i++;
+        }
+        counts_[i].fetch_add(1, std::memory_order_relaxed);
+        sum_.add(value);
+    }
+    const std::vector<double>& bounds() const { return bounds_; }
+    uint64_t count(size_t bucket) const { return counts_[bucket].load(std::memory_order_relaxed); }
+    double sum() const { return sum_.get(); }
+private:
+    std::vector<double> bounds_;
+    std::vector<std::atomic<uint64_t>> counts_;
+    AtomicDouble sum_;
+};
+
+// process wide metrics exported as prometheus text. metrics are registered once (e.g. into
+// a function local static reference) and updated lock-free from any thread; `labels` is
+// the label set without braces, e.g. `stage="encoder"`
+class Metrics
+{
+public:
+    static Metrics& global();
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds,
+                         const std::string& labels = "");
+    // runs before every export, e.g. to sample a queue depth into a gauge
+    void on_collect(std::function<void()> collect);
+    std::string prometheus();
+    // replaces `path` atomically, for the node exporter textfile collector
+    bool write(const std::string& path);
+    // write() every `interval_ms` on a background thread until stop_writer()
+    void start_writer(const std::string& path, int interval_ms);
+    void stop_writer();
+    ~Metrics();
+private:
+    enum Type { COUNTER, GAUGE, HISTOGRAM };
+    struct Entry
+    {
+        Type type;
+        std::string name;
+        std::string help;
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+    Entry* find(Type type, const std::string& name, const std::string& labels);
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::vector<std::function<void()>> collects_;
+    std::thread writer_;
+    std::mutex writer_mutex_;
+    std::condition_variable writer_cv_;
+    bool writer_stop_ = false;
+};
+
+#endif //METRICS_H
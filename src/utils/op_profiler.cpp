@@ -0,0 +1,118 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#include "op_profiler.h"
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+void OpProfiler::install(const std::shared_ptr<MNN::Express::Executor>& executor)
+{
+    executor_ = executor;
+    MNN::TensorCallBackWithInfo before = [this](const std::vector<MNN::Tensor*>&, const MNN::OperatorInfo*)
+    {
+        start_ = std::chrono::steady_clock::now();
+        return true;
+    };
+    MNN::TensorCallBackWithInfo after = [this](const std::vector<MNN::Tensor*>&, const MNN::OperatorInfo* info)
+    {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+        float mflops = info->flops();
+        auto& type = types_[info->type()];
+        type.type = info->type();
+        type.count++;
+        type.ms += ms;
+        type.mflops += mflops;
+        auto& layer = layers_[scope_.empty() ? info->name() : scope_ + "/" + info->name()];
+        layer.type = info->type();
+        layer.count++;
+        layer.ms += ms;
+        layer.mflops += mflops;
+        total_ms_ += ms;
+        return true;
+    };
+    executor_->setCallBack(std::move(before), std::move(after));
+}
+
+void OpProfiler::uninstall()
+{
+    if (executor_)
+    {
+        executor_->setCallBack(nullptr, nullptr);
+        executor_.reset();
+    }
+}
+
+void OpProfiler::reset()
+{
+    types_.clear();
+    layers_.clear();
+    total_ms_ = 0;
+}
+
+static std::vector<std::pair<std::string, OpProfiler::Stat>> sorted(const std::map<std::string, OpProfiler::Stat>& stats,
+                                                                     int top)
+{
+    std::vector<std::pair<std::string, OpProfiler::Stat>> items(stats.begin(), stats.end());
+    std::sort(items.begin(), items.end(), [](const std::pair<std::string, OpProfiler::Stat>& a,
+                                             const std::pair<std::string, OpProfiler::Stat>& b)
+    {
+        return a.second.ms > b.second.ms;
+    });
+    if (top > 0 && static_cast<int>(items.size()) > top)
+    {
+        items.resize(top);
+    }
+    return items;
+}
+
+std::string OpProfiler::report(int top) const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "total " << total_ms_ << "ms\n";
+    out << std::left << std::setw(24) << "op type" << std::right << std::setw(10) << "count" << std::setw(12) << "ms"
+        << std::setw(8) << "%" << std::setw(14) << "mflops" << std::setw(10) << "gflop/s" << "\n";
+    for (const auto& item : sorted(types_, top))
+    {
+        const auto& stat = item.second;
+        out << std::left << std::setw(24) << item.first << std::right << std::setw(10) << stat.count
+            << std::setw(12) << stat.ms << std::setw(8) << (total_ms_ > 0 ? 100 * stat.ms / total_ms_ : 0)
+            << std::setw(14) << stat.mflops << std::setw(10) << (stat.ms > 0 ? stat.mflops / stat.ms : 0) << "\n";
+    }
+    out << std::left << std::setw(48) << "layer" << std::setw(16) << "type" << std::right << std::setw(10) << "count"
+        << std::setw(12) << "ms" << std::setw(14) << "mflops" << "\n";
+    for (const auto& item : sorted(layers_, top))
+    {
+        const auto& stat = item.second;
+        out << std::left << std::setw(48) << item.first << std::setw(16) << stat.type << std::right
+            << std::setw(10) << stat.count << std::setw(12) << stat.ms << std::setw(14) << stat.mflops << "\n";
+    }
+    return out.str();
+}
+
+std::string OpProfiler::json(int top) const
+{
+    std::ostringstream json;
+    auto write = [&](const char* key, const std::map<std::string, Stat>& stats)
+    {
+        json << "\"" << key << "\": [";
+        bool first = true;
+        for (const auto& item : sorted(stats, top))
+        {
+            json << (first ? "" : ", ") << "{\"name\": \"" << item.first << "\", \"type\": \"" << item.second.type
+                 << "\", \"count\": " << item.second.count << ", \"ms\": " << item.second.ms
+                 << ", \"mflops\": " << item.second.mflops << "}";
+            first = false;
+        }
+        json << "]";
+    };
+    json << "{\"total_ms\": " << total_ms_ << ", ";
+    write("types", types_);
+    json << ", ";
+    write("layers", layers_);
+    json << "}";
+    return json.str();
+}
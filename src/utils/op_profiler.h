@@ -0,0 +1,49 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef OP_PROFILER_H
+#define OP_PROFILER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <MNN/expr/Executor.hpp>
+
+// time and flops of every operator an executor runs, through MNN's before/after callbacks,
+// aggregated per op type and per layer over any number of forwards. the wall time between
+// the callbacks is the op's cost on the cpu backend, asynchronous gpu backends only report
+// the time to enqueue. lazy expressions computed by a forward (e.g. the frontend feeding the
+// encoder) count towards its scope. a profiler serves one executor on one thread
+class OpProfiler
+{
+public:
+    struct Stat
+    {
+        std::string type;
+        long count = 0;
+        double ms = 0;
+        double mflops = 0;
+    };
+
+    // installs the callbacks on `executor`, uninstall() removes them
+    void install(const std::shared_ptr<MNN::Express::Executor>& executor);
+    void uninstall();
+    // module the following ops belong to, prefixes the layer names
+    void scope(const std::string& module) { scope_ = module; }
+    void reset();
+    // the `top` op types and layers by total time
+    std::string report(int top = 20) const;
+    std::string json(int top = 20) const;
+
+private:
+    std::shared_ptr<MNN::Express::Executor> executor_;
+    std::string scope_;
+    std::chrono::steady_clock::time_point start_;
+    std::map<std::string, Stat> types_;
+    std::map<std::string, Stat> layers_;
+    double total_ms_ = 0;
+};
+
+#endif //OP_PROFILER_H
@@ -0,0 +1,308 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef PCM_RING_H
+#define PCM_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// end marks the producer may place ahead of the consumer
+static constexpr uint64_t PCM_RING_END_MARKS = 16;
+
+// ring state, in process memory or at the start of a shared mapping followed by the samples.
+// a stream ends at a mark, the tail when the producer finished it: the producer counts
+// `finished` streams, the consumer `ended` the ones it read to their mark
+struct PcmRingHeader
+{
+    uint32_t magic;
+    uint32_t sample_rate;
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint64_t> ended;
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> finished;
+    std::atomic<uint64_t> ends[PCM_RING_END_MARKS];
+};
+
+// lock-free ring of pcm samples for one producer thread (e.g. a socket thread) and one
+// consumer thread, push never waits and pop takes whole blocks of samples. the producer may
+// go on with the next stream right after finish(), the consumer reads a stream up to its
+// end mark and then moves on with next_stream(). a shared ring
+// lives in a posix shared memory object so a producer process on the same host writes
+// samples the consumer reads in place
+class PcmRing
+{
+public:
+    static constexpr uint32_t MAGIC = 0x324e5250; // "PRN2"
+
+    // process local ring, capacity is rounded up to a power of two
+    explicit PcmRing(size_t capacity)
+    {
+        // placed by hand, operator new of c++11 ignores the cache line alignment
+        local_header_.resize(sizeof(PcmRingHeader) + 64);
+        void* ptr = local_header_.data();
+        size_t space = local_header_.size();
+        header_ = new (std::align(64, sizeof(PcmRingHeader), ptr, space)) PcmRingHeader;
+        local_buffer_.resize(round_up(capacity));
+        init(header_, local_buffer_.size(), 0);
+        buffer_ = local_buffer_.data();
+        mask_ = local_buffer_.size() - 1;
+    }
+
+    ~PcmRing()
+    {
+        if (mapping_)
+        {
+            ::munmap(mapping_, mapping_size_);
+        }
+        if (owner_)
+        {
+            ::shm_unlink(name_.c_str());
+        }
+    }
+
+    // producer side: create the shared memory object `name` (e.g. "/asr_stream_1"),
+    // it is unlinked when the creating ring is destroyed
+    static PcmRing* create_shared(const std::string& name, size_t capacity, int sample_rate)
+    {
+        capacity = round_up(capacity);
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        size_t size = data_offset() + capacity * sizeof(float);
+        std::unique_ptr<PcmRing> ring(new PcmRing);
+        ring->name_ = name;
+        ring->owner_ = true;
+        if (::ftruncate(fd, size) != 0 || !ring->map(fd, size))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        ::close(fd);
+        init(new (ring->mapping_) PcmRingHeader, capacity, sample_rate);
+        ring->mask_ = capacity - 1;
+        return ring.release();
+    }
+
+    // consumer side: map a ring created by create_shared()
+    static PcmRing* open_shared(const std::string& name)
+    {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        std::unique_ptr<PcmRing> ring(new PcmRing);
+        ring->name_ = name;
+        off_t size = ::lseek(fd, 0, SEEK_END);
+        if (size < static_cast<off_t>(data_offset()) || !ring->map(fd, size))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        ::close(fd);
+        auto header = ring->header_;
+        uint64_t capacity = header->capacity;
+        // the capacity comes from the peer, bounded by the mapping without overflowing
+        if (header->magic != MAGIC || capacity < 2 || (capacity & (capacity - 1)) ||
+            capacity > (static_cast<size_t>(size) - data_offset()) / sizeof(float))
+        {
+            return nullptr;
+        }
+        ring->mask_ = capacity - 1;
+        return ring.release();
+    }
+
+    bool shared() const { return mapping_ != nullptr; }
+    int sample_rate() const { return header_->sample_rate; }
+    size_t capacity() const { return mask_ + 1; }
+
+    // producer: copies as many samples as fit, returns the count
+    size_t push(const float* data, size_t size)
+    {
+        uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        size_t free = capacity() - (tail - header_->head.load(std::memory_order_acquire));
+        size = std::min(size, free);
+        size_t offset = tail & mask_;
+        size_t first = std::min(size, capacity() - offset);
+        ::memcpy(buffer_ + offset, data, first * sizeof(float));
+        ::memcpy(buffer_, data + first, (size - first) * sizeof(float));
+        header_->tail.store(tail + size, std::memory_order_release);
+        return size;
+    }
+
+    // producer: no more samples for this stream, the next push() starts the next one.
+    // false while PCM_RING_END_MARKS finished streams are still unread
+    bool finish()
+    {
+        uint64_t finished = header_->finished.load(std::memory_order_relaxed);
+        if (finished - header_->ended.load(std::memory_order_acquire) >= PCM_RING_END_MARKS)
+        {
+            return false;
+        }
+        header_->ends[finished % PCM_RING_END_MARKS].store(header_->tail.load(std::memory_order_relaxed),
+                                                           std::memory_order_relaxed);
+        header_->finished.store(finished + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: `size` contiguous samples at the read position without copying, nullptr when
+    // fewer are available or they wrap around the end; consume() them once they are used
+    const float* peek(size_t size) const
+    {
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        size_t offset = head & mask_;
+        if (limit() - head < size || offset + size > capacity())
+        {
+            return nullptr;
+        }
+        return buffer_ + offset;
+    }
+
+    void consume(size_t size)
+    {
+        header_->head.fetch_add(size, std::memory_order_release);
+    }
+
+    // consumer: exactly `size` samples or nothing
+    bool pop(float* data, size_t size)
+    {
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        if (limit() - head < size)
+        {
+            return false;
+        }
+        size_t offset = head & mask_;
+        size_t first = std::min(size, capacity() - offset);
+        ::memcpy(data, buffer_ + offset, first * sizeof(float));
+        ::memcpy(data + first, buffer_, (size - first) * sizeof(float));
+        header_->head.store(head + size, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: up to `size` samples, returns the count
+    size_t pop_some(float* data, size_t size)
+    {
+        size = std::min(size, available());
+        return pop(data, size) ? size : 0;
+    }
+
+    // consumer: samples of the current stream
+    size_t available() const
+    {
+        return limit() - header_->head.load(std::memory_order_relaxed);
+    }
+
+    // consumer: the producer finished the current stream, available() is all that is left
+    bool finished() const
+    {
+        return header_->finished.load(std::memory_order_acquire) > header_->ended.load(std::memory_order_relaxed);
+    }
+
+    // consumer: after the current stream was read to its end mark, go on with the next one
+    bool next_stream()
+    {
+        if (!finished() || available())
+        {
+            return false;
+        }
+        header_->ended.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    // only while neither side is using the ring
+    void reset()
+    {
+        header_->head.store(0);
+        header_->ended.store(0);
+        header_->tail.store(0);
+        header_->finished.store(0);
+    }
+
+private:
+    PcmRing() = default;
+
+    // consumer: the read limit, the end mark of the current stream once it is finished.
+    // the mark is stored before `finished`, the acquire load makes it visible. a shared
+    // ring's producer is another process: a limit behind the read position or more than a
+    // ring ahead of it is clamped, reads never leave the buffer
+    uint64_t limit() const
+    {
+        uint64_t ended = header_->ended.load(std::memory_order_relaxed);
+        uint64_t limit = header_->finished.load(std::memory_order_acquire) > ended ?
+            header_->ends[ended % PCM_RING_END_MARKS].load(std::memory_order_relaxed) :
+            header_->tail.load(std::memory_order_acquire);
+        uint64_t head = header_->head.load(std::memory_order_relaxed);
+        if (limit - head > capacity())
+        {
+            return limit < head ? head : head + capacity();
+        }
+        return limit;
+    }
+
+    static size_t round_up(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    static size_t data_offset()
+    {
+        return (sizeof(PcmRingHeader) + 63) / 64 * 64;
+    }
+
+    static void init(PcmRingHeader* header, size_t capacity, int sample_rate)
+    {
+        header->magic = MAGIC;
+        header->sample_rate = sample_rate;
+        header->capacity = capacity;
+        header->head.store(0);
+        header->ended.store(0);
+        header->tail.store(0);
+        header->finished.store(0);
+    }
+
+    bool map(int fd, size_t size)
+    {
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            return false;
+        }
+        mapping_ = ptr;
+        mapping_size_ = size;
+        header_ = static_cast<PcmRingHeader*>(ptr);
+        buffer_ = reinterpret_cast<float*>(static_cast<char*>(ptr) + data_offset());
+        return true;
+    }
+
+private:
+    std::vector<char> local_header_;
+    std::vector<float> local_buffer_;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::string name_;
+    bool owner_ = false;
+    PcmRingHeader* header_ = nullptr;
+    float* buffer_ = nullptr;
+    size_t mask_ = 0;
+};
+
+#endif //PCM_RING_H
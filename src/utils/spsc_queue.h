@@ -0,0 +1,112 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// bounded lock-free queue for exactly one producer thread and one consumer thread
+template <typename T>
+class SpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    bool try_push(T&& item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_)
+        {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // block with backoff until the item is queued or `stop` is set
+    bool push(T&& item, const std::atomic<bool>& stop)
+    {
+        for (int spins = 0; !try_push(std::move(item)); spins++)
+        {
+            if (stop.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+            backoff(spins);
+        }
+        return true;
+    }
+
+    // block with backoff until an item arrives or `stop` is set
+    bool pop(T& item, const std::atomic<bool>& stop)
+    {
+        for (int spins = 0; !try_pop(item); spins++)
+        {
+            if (stop.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+            backoff(spins);
+        }
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static void backoff(int spins)
+    {
+        if (spins < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_;
+    // consumer and producer positions on their own cache lines. padded rather than alignas:
+    // plain new under c++11 doesn't honour an over-aligned type
+    char pad0_[64];
+    std::atomic<size_t> head_{0};
+    char pad1_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_{0};
+    char pad2_[64 - sizeof(std::atomic<size_t>)];
+};
+
+#endif //SPSC_QUEUE_H
@@ -1,7 +1,8 @@
 #ifndef TIMER_H
 #define TIMER_H
 
-#include <sys/time.h> //test
+#include <chrono>
+#include <sstream>
 #include <iostream>
 
 class Timer
@@ -14,9 +15,7 @@ public:
 
     double Timing(const std::string message = "", bool print = false)
     {
-        gettimeofday(&end, nullptr);
-        double timeuse = (1000000 * (end.tv_sec - start.tv_sec) + end.tv_usec -
-                          start.tv_usec) * 1.0 / 1000;
+        double timeuse = Elapsed();
 
         if ("" != message)
         {
@@ -33,9 +32,7 @@ public:
 
     std::string TimingStr(const std::string message = "", bool print = false)
     {
-        gettimeofday(&end, nullptr);
-        double timeuse = (1000000 * (end.tv_sec - start.tv_sec) + end.tv_usec -
-                          start.tv_usec) * 1.0 / 1000;
+        double timeuse = Elapsed();
 
         std::ostringstream useTime("");
 
@@ -57,11 +54,17 @@ public:
 private:
     void Start()
     {
-        gettimeofday(&start, nullptr);
+        start = std::chrono::steady_clock::now();
+    }
+
+    // monotonic, ms with sub-microsecond resolution
+    double Elapsed() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
     }
 
 private:
-    struct timeval start, end;
+    std::chrono::steady_clock::time_point start;
 };
 
 
@@ -0,0 +1,148 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#include "trace.h"
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
+
+std::atomic<bool> Tracer::enabled_(false);
+
+namespace
+{
+struct TraceEvent
+{
+    const char* name;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+// spans of one thread; the lock is only contended while a dump or clear runs
+struct TraceBuffer
+{
+    int tid = 0;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+};
+
+struct TraceRegistry
+{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    int64_t origin_ns = Tracer::now();
+};
+
+// never destroyed, the exit dump runs after static destructors
+TraceRegistry& registry()
+{
+    static TraceRegistry* instance = new TraceRegistry;
+    return *instance;
+}
+
+TraceBuffer& thread_buffer()
+{
+    // the registry keeps the buffer after its thread exits
+    static thread_local std::shared_ptr<TraceBuffer> buffer;
+    if (!buffer)
+    {
+        buffer = std::make_shared<TraceBuffer>();
+        buffer->events.reserve(4096);
+        auto& spans = registry();
+        std::lock_guard<std::mutex> lock(spans.mutex);
+        buffer->tid = static_cast<int>(spans.buffers.size()) + 1;
+        spans.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+std::string exit_path;
+
+void dump_at_exit()
+{
+    Tracer::dump(exit_path);
+}
+
+// ASR_TRACE=path enables tracing for the whole run
+struct EnvironmentTrace
+{
+    EnvironmentTrace()
+    {
+        const char* path = std::getenv("ASR_TRACE");
+        if (path && *path)
+        {
+            exit_path = path;
+            Tracer::enable(true);
+            std::atexit(dump_at_exit);
+        }
+    }
+} environment_trace;
+}
+
+void Tracer::enable(bool enabled)
+{
+    // timestamps are relative to the registry's creation, before the first span starts
+    registry();
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char* name, int64_t start_ns, int64_t end_ns)
+{
+    auto& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back({name, start_ns, end_ns});
+}
+
+void Tracer::clear()
+{
+    auto& spans = registry();
+    std::lock_guard<std::mutex> lock(spans.mutex);
+    for (auto& buffer : spans.buffers)
+    {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+    }
+}
+
+std::string Tracer::json()
+{
+    auto& spans = registry();
+    int pid = static_cast<int>(::getpid());
+    std::ostringstream json;
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(spans.mutex);
+    for (auto& buffer : spans.buffers)
+    {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        json << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+             << ", \"tid\": " << buffer->tid << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+        first = false;
+        for (const auto& event : buffer->events)
+        {
+            json << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": " << pid
+                 << ", \"tid\": " << buffer->tid
+                 << ", \"ts\": " << (event.start_ns - spans.origin_ns) / 1000.0
+                 << ", \"dur\": " << (event.end_ns - event.start_ns) / 1000.0 << "}";
+        }
+    }
+    json << "\n]}";
+    return json.str();
+}
+
+bool Tracer::dump(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << json() << std::endl;
+    return file.good();
+}
@@ -0,0 +1,77 @@
+//
+// Created by smart on 2026/10/18.
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// scoped spans on the hot path, written to per-thread buffers and exported as chrome trace
+// json (chrome://tracing, ui.perfetto.dev). spans are compiled in unless ASR_NO_TRACE is
+// defined and cost one relaxed atomic load while tracing is disabled at runtime.
+// ASR_TRACE=trace.json in the environment enables tracing at startup and dumps at exit.
+// MNN evaluates lazily: a span around graph building holds the compute only where the
+// span reads a result (readMap) or runs a module (onForward)
+class Tracer
+{
+public:
+    static void enable(bool enabled);
+    static bool enabled()
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+    // drop the recorded spans
+    static void clear();
+    static std::string json();
+    static bool dump(const std::string& path);
+    // `name` must outlive the dump, a string literal
+    static void record(const char* name, int64_t start_ns, int64_t end_ns);
+    static int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+private:
+    static std::atomic<bool> enabled_;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name) : name_(Tracer::enabled() ? name : nullptr)
+    {
+        if (name_)
+        {
+            start_ = Tracer::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (name_)
+        {
+            Tracer::record(name_, start_, Tracer::now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_ = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#ifdef ASR_NO_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#endif
+
+#endif //TRACE_H
@@ -10,80 +10,41 @@
 #include <vector>
 #include <iterator>
 #include <sstream>
+#include <type_traits>
 #include <dirent.h>
+#include "logger.h"
 
 
 #define FUNC_NAME __FUNCTION__
-const std::string MODULE_NAME = "SpeechReconstruction";
-#define FILE (std::string(__FILE__).substr(std::string(__FILE__).find(std::string("src"))))
-#define FILE_LINE (FILE + ":" + std::to_string(__LINE__))
-#define MODULE_LINE ("[" + std::string(MODULE_NAME) + "] [" + FILE_LINE) + "] "
-#define MODULE_LINE_FUNCTION (MODULE_LINE + "[" + std::string(FUNC_NAME) + "] ")
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+// `src/path/file.cpp:line` as a string literal, no work at the call site
+#define FILE_LINE (__FILE__ ":" STRINGIFY(__LINE__) + \
+                   std::integral_constant<size_t, logger_detail::source_offset(__FILE__)>::value)
 
-class LogStream {
-public:
-    enum LogLevel { ERROR, WARNING, INFO, LOG, DEBUG, TRACE };
-
-    LogStream(LogLevel level) : level_(level) {}
-
-    template<typename T>
-    LogStream& operator<<(const T& value) {
-        stream_ << value;
-        return *this;
-    }
-
-    ~LogStream() {
-        std::string message = stream_.str();
-        switch(level_) {
-        case ERROR:
-            std::cout << "\033[31m" << "[ERROR] " << message << "\033[0m" << std::endl;
-            break;
-        case WARNING:
-            std::cout << "\033[33m" << "[WARNING] " << message << "\033[0m" << std::endl;
-            break;
-        case INFO:
-            std::cout << "\033[32m" << "[INFO] " << message << "\033[0m" << std::endl;
-            break;
-        case LOG:
-            std::cout << "[LOG] " << message << std::endl;
-            break;
-        case DEBUG:
-            std::cout << "\033[34m" << "[DEBUG] " << message << "\033[0m" << std::endl;
-            break;
-        case TRACE:
-            std::cout << "\033[35m" << "[TRACE] " << message << "\033[0m" << std::endl;
-            break;
-        default:
-            std::cout << message << std::endl;
-            break;
-        }
-    }
-
-private:
-    LogLevel level_;
-    std::stringstream stream_;
-};
+// the stream and its arguments are only evaluated when the level is enabled
+#define LOG_AT(level) if (!Logger::enabled(level)) {} else LogStream(level, FILE_LINE, FUNC_NAME)
 
 // log
-#define LOG_ERROR LogStream(LogStream::ERROR)
-#define LOG_WARNING LogStream(LogStream::WARNING)
-#define LOG_INFO LogStream(LogStream::INFO)
-#define LOG_DEBUG LogStream(LogStream::DEBUG)
-#define LOG LogStream(LogStream::LOG)
+#define LOG_ERROR LOG_AT(LogStream::ERROR)
+#define LOG_WARNING LOG_AT(LogStream::WARNING)
+#define LOG_INFO LOG_AT(LogStream::INFO)
+#define LOG_DEBUG LOG_AT(LogStream::DEBUG)
+#define LOG LOG_AT(LogStream::LOG)
 
 
 // print
-#define ERROR_PRINT(x) LOG_ERROR << MODULE_LINE_FUNCTION << (x)
-#define WARNING_PRINT(x) LOG_WARNING << MODULE_LINE_FUNCTION << (x)
-#define INFO_PRINT(x) LOG_INFO << MODULE_LINE_FUNCTION << (x)
+#define ERROR_PRINT(x) LOG_ERROR << (x)
+#define WARNING_PRINT(x) LOG_WARNING << (x)
+#define INFO_PRINT(x) LOG_INFO << (x)
 #ifdef NDEBUG
 #define DEBUG_PRINT(x)
 #else
-#define DEBUG_PRINT(x) LOG_DEBUG << MODULE_LINE_FUNCTION << (x)
+#define DEBUG_PRINT(x) LOG_DEBUG << (x)
 #endif
-#define LOG_PRINT(x) LOG << MODULE_LINE_FUNCTION << (x)
+#define LOG_PRINT(x) LOG << (x)
 
-#define TIMING(x) LogStream(LogStream::TRACE) << MODULE_LINE_FUNCTION << (x)
+#define TIMING(x) LOG_AT(LogStream::TRACE) << (x)
 
 #define PRINTF(a) (std::cout << "" << (#a) << " = " << (a) << "" << std::endl)
 #define RELEASE(p) do{if (p != nullptr) delete (p); (p) = nullptr;}while(0)
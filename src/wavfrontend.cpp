@@ -7,6 +7,7 @@
 #include <MNN/expr/Expr.hpp>
 #include <MNN/expr/ExprCreator.hpp>
 #include <audio/audio.hpp>
+#include "utils/trace.h"
 
 MNN::Express::VARP WavFrontend::apply_cmvn(MNN::Express::VARP samples)
 {
@@ -52,10 +53,22 @@ MNN::Express::VARP WavFrontend::apply_lfr(MNN::Express::VARP samples)
     return samples;
 }
 
-MNN::Express::VARP WavFrontend::extract_feat(MNN::Express::VARP waveforms)
+MNN::Express::VARP WavFrontend::fbank(MNN::Express::VARP waveforms)
 {
+    TRACE_SCOPE("fbank");
     waveforms = waveforms * MNN::Express::_Scalar<float>(32768);
     auto feature = MNN::AUDIO::fbank(waveforms);
+    // computed inside the span only while tracing, lazily otherwise
+    if (Tracer::enabled())
+    {
+        feature->readMap<float>();
+    }
+    return feature;
+}
+
+MNN::Express::VARP WavFrontend::extract_feat(MNN::Express::VARP waveforms)
+{
+    auto feature = fbank(waveforms);
     feature = apply_lfr(feature);
     feature = apply_cmvn(feature);
     return feature;
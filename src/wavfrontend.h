@@ -27,6 +27,8 @@ public:
     MNN::Express::VARP apply_lfr(MNN::Express::VARP samples);
     MNN::Express::VARP apply_cmvn(MNN::Express::VARP samples);
     MNN::Express::VARP extract_feat(MNN::Express::VARP samples);
+    // kaldi fbank of the waveform, extract_feat() without lfr/cmvn
+    MNN::Express::VARP fbank(MNN::Express::VARP samples);
 
 private:
     std::shared_ptr<SR::AsrConfig> config_;
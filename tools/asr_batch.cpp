@@ -0,0 +1,234 @@
+//
+//  asr_batch.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asrpool.hpp"
+#include <audio/audio.hpp>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdio>
+#include "utils/utils.h"
+#include "utils/timer.h"
+
+void Help()
+{
+    ERROR_PRINT("please input: ");
+    INFO_PRINT("\tconfig.json");
+    INFO_PRINT("\twav directory, or manifest with one wav path per line");
+    INFO_PRINT("\toutput.jsonl");
+    INFO_PRINT("\t[workers], default is 4");
+    INFO_PRINT("\t[mode], online or offline (padded batches of whole files), default is online");
+}
+
+static bool is_dir(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void list_wavs(const std::string& dir, std::vector<std::string>& wavs)
+{
+    DIR* handle = opendir(dir.c_str());
+    if (!handle)
+    {
+        return;
+    }
+    while (auto entry = readdir(handle))
+    {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        std::string path = dir + "/" + name;
+        if (is_dir(path))
+        {
+            list_wavs(path, wavs);
+        }
+        else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0)
+        {
+            wavs.push_back(path);
+        }
+    }
+    closedir(handle);
+}
+
+// first field of every line, relative paths are resolved against the manifest
+static void read_manifest(const std::string& manifest, std::vector<std::string>& wavs)
+{
+    std::ifstream file(manifest);
+    size_t pos = manifest.find_last_of("/\\");
+    std::string base_dir = pos == std::string::npos ? "" : manifest.substr(0, pos + 1);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::string path = line.substr(0, line.find_first_of(" \t\r"));
+        if (path.empty())
+        {
+            continue;
+        }
+        wavs.push_back(path[0] == '/' ? path : base_dir + path);
+    }
+}
+
+static std::string json_escape(const std::string& str)
+{
+    std::string out;
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        case '\r': out += "\\r"; break;
+        default:
+            // json strings can't hold raw control characters
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[7];
+                snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+                out += code;
+            }
+            else
+            {
+                out += c;
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 4)
+    {
+        Help();
+        return 0;
+    }
+    std::string config_path = argv[1];
+    std::string input = argv[2];
+    std::string output = argv[3];
+    int workers = argc > 4 ? std::max(1, std::atoi(argv[4])) : 4;
+    bool offline = argc > 5 && std::string(argv[5]) == "offline";
+
+    std::vector<std::string> wavs;
+    if (is_dir(input))
+    {
+        list_wavs(input, wavs);
+        std::sort(wavs.begin(), wavs.end());
+    }
+    else
+    {
+        read_manifest(input, wavs);
+    }
+    if (wavs.empty())
+    {
+        ERROR_PRINT("Error: no wav files found in: " + input);
+        return 1;
+    }
+    // offline workers take neighbouring files, sorting by size keeps their lengths close
+    size_t group = offline ? 32 : 1;
+    if (offline)
+    {
+        std::vector<std::pair<off_t, std::string>> sized;
+        for (const auto& wav : wavs)
+        {
+            struct stat st;
+            sized.emplace_back(stat(wav.c_str(), &st) == 0 ? st.st_size : 0, wav);
+        }
+        std::sort(sized.begin(), sized.end());
+        for (size_t i = 0; i < sized.size(); i++)
+        {
+            wavs[i] = sized[i].second;
+        }
+    }
+    std::ofstream jsonl(output);
+    if (!jsonl.is_open())
+    {
+        ERROR_PRINT("Error: unable to open output file: " + output);
+        return 1;
+    }
+
+    // load once, every worker of the pool runs on a clone sharing the weights
+    std::unique_ptr<SR::Asr> asr(SR::Asr::createASR(config_path));
+    if (!asr->load())
+    {
+        return 1;
+    }
+    std::unique_ptr<SR::AsrPool> pool(SR::AsrPool::create(*asr, workers));
+    if (!pool)
+    {
+        return 1;
+    }
+    INFO_PRINT("✓ " + std::to_string(wavs.size()) + " files, " + std::to_string(workers) + " workers");
+
+    std::mutex output_mutex;
+    double total_audio = 0, total_infer = 0;
+    size_t failed = 0;
+    Timer timer_total;
+    for (size_t begin = 0; begin < wavs.size(); begin += group)
+    {
+        size_t end = std::min(begin + group, wavs.size());
+        pool->submit([&, begin, end](SR::Asr& worker)
+        {
+            Timer timer;
+            std::vector<std::string> paths;
+            std::vector<MNN::Express::VARP> speeches;
+            std::vector<double> durations;
+            std::vector<int> sample_rates;
+            double batch_audio = 0;
+            for (size_t index = begin; index < end; index++)
+            {
+                auto audio = MNN::AUDIO::load(wavs[index]);
+                if (audio.first.get() == nullptr || audio.second <= 0)
+                {
+                    std::lock_guard<std::mutex> lock(output_mutex);
+                    ERROR_PRINT("Error: failed to load wav: " + wavs[index]);
+                    failed++;
+                    continue;
+                }
+                paths.push_back(wavs[index]);
+                speeches.push_back(audio.first);
+                sample_rates.push_back(audio.second);
+                durations.push_back(static_cast<double>(audio.first->getInfo()->size) / audio.second);
+                batch_audio += durations.back();
+            }
+            std::vector<std::string> texts;
+            if (offline)
+            {
+                texts = worker.offline_recognize(speeches, sample_rates);
+            }
+            else if (!speeches.empty())
+            {
+                texts.push_back(worker.online_recognize(speeches[0], sample_rates[0]));
+            }
+            // batched files share the batch time in proportion to their duration
+            double infer_ms = timer.Timing();
+            std::lock_guard<std::mutex> lock(output_mutex);
+            for (size_t i = 0; i < texts.size(); i++)
+            {
+                jsonl << "{\"path\": \"" << json_escape(paths[i]) << "\", \"text\": \"" << json_escape(texts[i])
+                      << "\", \"duration\": " << durations[i] << ", \"rtf\": " << infer_ms / 1000.0 / batch_audio
+                      << "}" << std::endl;
+            }
+            total_audio += batch_audio;
+            total_infer += infer_ms / 1000.0;
+        });
+    }
+    pool->wait();
+    double wall = timer_total.Timing() / 1000.0;
+
+    std::ostringstream summary;
+    summary << "files: " << wavs.size() - failed << ", failed: " << failed
+            << ", audio: " << total_audio << "s, wall: " << wall << "s"
+            << ", throughput: " << total_audio / wall << "x realtime"
+            << ", mean rtf: " << total_infer / total_audio;
+    LOG_PRINT(summary.str());
+    INFO_PRINT("✓ Results saved to: " + output);
+    return failed == 0 ? 0 : 1;
+}
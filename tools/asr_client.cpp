@@ -0,0 +1,223 @@
+//
+//  asr_client.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asr_protocol.h"
+#include <audio/audio.hpp>
+#include "utils/pcm_ring.h"
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include "utils/utils.h"
+#include "utils/timer.h"
+
+using namespace SR::protocol;
+
+void Help()
+{
+    ERROR_PRINT("please input: ");
+    INFO_PRINT("\tserver address, unix:/path/to.sock or host:port");
+    INFO_PRINT("\ttest.wav");
+    INFO_PRINT("\t[streams], concurrent connections sending the wav, default is 1");
+    INFO_PRINT("\t[realtime], 1 paces the audio at its duration, default is 0");
+    INFO_PRINT("\t[transport], socket or shm (shared memory ring per stream), default is socket");
+}
+
+static bool send_all(int fd, const std::string& data)
+{
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        ssize_t size = ::send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (size <= 0)
+        {
+            return false;
+        }
+        offset += size;
+    }
+    return true;
+}
+
+static bool recv_all(int fd, char* data, size_t size)
+{
+    size_t offset = 0;
+    while (offset < size)
+    {
+        ssize_t got = ::recv(fd, data + offset, size - offset, 0);
+        if (got <= 0)
+        {
+            return false;
+        }
+        offset += got;
+    }
+    return true;
+}
+
+// stream the wav in 600ms frames, read partial texts until FINAL
+static bool run_stream(const std::string& target, const std::vector<int16_t>& pcm, int sample_rate,
+                       bool realtime, bool shm, int index, std::mutex& print_mutex)
+{
+    std::unique_ptr<PcmRing> ring;
+    std::string shm_name;
+    if (shm)
+    {
+        std::string name = "/asr_client_" + std::to_string(::getpid()) + "_" + std::to_string(index);
+        ring.reset(PcmRing::create_shared(name, static_cast<size_t>(sample_rate) * 10, sample_rate));
+        if (!ring)
+        {
+            std::lock_guard<std::mutex> lock(print_mutex);
+            ERROR_PRINT("Error: unable to create shared memory ring: " + name);
+            return false;
+        }
+        shm_name = name;
+    }
+    sockaddr_storage addr;
+    socklen_t length = 0;
+    int fd = address(target, addr, length);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), length) != 0)
+    {
+        std::lock_guard<std::mutex> lock(print_mutex);
+        ERROR_PRINT("Error: unable to connect to: " + target);
+        return false;
+    }
+    Timer timer;
+    std::thread sender([&]()
+    {
+        int32_t rate = sample_rate;
+        send_all(fd, ring ? frame(FRAME_ATTACH, shm_name) : frame(FRAME_BEGIN, &rate, 4));
+        size_t chunk = static_cast<size_t>(sample_rate) * 6 / 10;
+        std::vector<float> samples;
+        for (size_t offset = 0; offset < pcm.size(); offset += chunk)
+        {
+            size_t size = std::min(chunk, pcm.size() - offset);
+            if (ring)
+            {
+                samples.resize(size);
+                for (size_t i = 0; i < size; i++)
+                {
+                    samples[i] = pcm[offset + i] / 32768.f;
+                }
+                // the ring is full until the server caught up
+                for (size_t pushed = 0; pushed < size;)
+                {
+                    pushed += ring->push(samples.data() + pushed, size - pushed);
+                    if (pushed < size)
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    }
+                }
+            }
+            else
+            {
+                send_all(fd, frame(FRAME_AUDIO, pcm.data() + offset, static_cast<uint32_t>(size * 2)));
+            }
+            if (realtime)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(size * 1000 / sample_rate));
+            }
+        }
+        if (ring)
+        {
+            ring->finish();
+        }
+        else
+        {
+            send_all(fd, frame(FRAME_END, nullptr, 0));
+        }
+        timer.Timing();
+    });
+    std::string text;
+    bool ok = false;
+    while (true)
+    {
+        char header[HEADER_SIZE];
+        if (!recv_all(fd, header, HEADER_SIZE))
+        {
+            break;
+        }
+        uint32_t size = 0;
+        ::memcpy(&size, header, 4);
+        std::string payload(std::min(size, MAX_PAYLOAD), '\0');
+        if (size > MAX_PAYLOAD || !recv_all(fd, &payload[0], size))
+        {
+            break;
+        }
+        uint8_t type = static_cast<uint8_t>(header[4]);
+        std::lock_guard<std::mutex> lock(print_mutex);
+        if (type == FRAME_PARTIAL)
+        {
+            text += payload;
+            DEBUG_PRINT("[" + std::to_string(index) + "] partial: " + text);
+        }
+        else if (type == FRAME_FINAL)
+        {
+            text += payload;
+            ok = true;
+            break;
+        }
+        else
+        {
+            ERROR_PRINT("[" + std::to_string(index) + "] error: " + payload);
+            break;
+        }
+    }
+    sender.join();
+    double final_ms = timer.Timing();
+    ::close(fd);
+    std::lock_guard<std::mutex> lock(print_mutex);
+    if (ok)
+    {
+        LOG_PRINT("[" + std::to_string(index) + "] " + text);
+        INFO_PRINT("[" + std::to_string(index) + "] final latency after end of audio: " + std::to_string(final_ms) + "ms");
+    }
+    return ok;
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 3)
+    {
+        Help();
+        return 0;
+    }
+    std::string target = argv[1];
+    std::string wav_file = argv[2];
+    int streams = argc > 3 ? std::max(1, std::atoi(argv[3])) : 1;
+    bool realtime = argc > 4 && std::atoi(argv[4]) != 0;
+    bool shm = argc > 5 && std::string(argv[5]) == "shm";
+
+    auto audio = MNN::AUDIO::load(wav_file);
+    if (audio.first.get() == nullptr || audio.second <= 0)
+    {
+        ERROR_PRINT("Error: failed to load wav: " + wav_file);
+        return 1;
+    }
+    auto ptr = audio.first->readMap<float>();
+    std::vector<int16_t> pcm(audio.first->getInfo()->size);
+    for (size_t i = 0; i < pcm.size(); i++)
+    {
+        pcm[i] = static_cast<int16_t>(std::max(-1.f, std::min(1.f, ptr[i])) * 32767);
+    }
+
+    std::mutex print_mutex;
+    std::vector<std::thread> threads;
+    int failed = 0;
+    for (int i = 0; i < streams; i++)
+    {
+        threads.emplace_back([&, i]()
+        {
+            if (!run_stream(target, pcm, audio.second, realtime, shm, i, print_mutex))
+            {
+                std::lock_guard<std::mutex> lock(print_mutex);
+                failed++;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+//
+//  asr_load.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asr.hpp"
+#include "asrconfig.hpp"
+#include <audio/audio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+#include "utils/utils.h"
+
+typedef std::chrono::steady_clock Clock;
+
+void Help()
+{
+    ERROR_PRINT("please input: ");
+    INFO_PRINT("\tconfig.json");
+    INFO_PRINT("\ttest.wav, looped by every stream");
+    INFO_PRINT("\t[p99 target], ms from the end of a chunk's audio to its partial text, default is 300");
+    INFO_PRINT("\t[workers], recognition threads, default is the number of cores");
+    INFO_PRINT("\t[seconds], duration of each trial, default is 20");
+    INFO_PRINT("\t[max streams], default is 256");
+    INFO_PRINT("\t[report.json]");
+}
+
+// one simulated call: audio arrives in real time, a worker recognizes each complete chunk
+struct Stream
+{
+    std::unique_ptr<SR::Asr> asr;
+    double offset_ms = 0;
+    size_t position = 0;
+    // guarded by the queue mutex
+    long completed = 0;
+    bool queued = false;
+    // the worker holding the stream
+    long processed = 0;
+};
+
+struct Trial
+{
+    int streams = 0;
+    double p50 = 0, p90 = 0, p99 = 0;
+    long chunks = 0;
+    long dropped = 0;
+};
+
+class LoadTest
+{
+public:
+    LoadTest(const SR::Asr& model, const float* pcm, size_t samples, int sample_rate, int chunk, int workers)
+        : model_(model), pcm_(pcm), samples_(samples), sample_rate_(sample_rate), chunk_(chunk),
+          chunk_ms_(1000.0 * chunk / sample_rate), workers_(workers) {}
+    bool run(int count, double seconds, Trial& trial);
+private:
+    void feed(Stream& stream, size_t target);
+    void work(std::vector<double>& latency);
+private:
+    const SR::Asr& model_;
+    const float* pcm_;
+    size_t samples_;
+    int sample_rate_;
+    int chunk_;
+    double chunk_ms_;
+    int workers_;
+    // clones are kept between trials
+    std::vector<std::unique_ptr<Stream>> streams_;
+    Clock::time_point start_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Stream*> queue_;
+    size_t dropped_ = 0;
+    bool stop_ = false;
+};
+
+// the wav is looped, samples the ring can't take are dropped like a late network packet
+void LoadTest::feed(Stream& stream, size_t target)
+{
+    while (stream.position < target)
+    {
+        size_t offset = stream.position % samples_;
+        size_t size = std::min(target - stream.position, samples_ - offset);
+        size_t fed = stream.asr->feed(pcm_ + offset, size);
+        stream.position += size;
+        if (fed < size)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            dropped_ += size - fed;
+        }
+    }
+}
+
+bool LoadTest::run(int count, double seconds, Trial& trial)
+{
+    while (static_cast<int>(streams_.size()) < count)
+    {
+        std::unique_ptr<Stream> stream(new Stream);
+        stream->asr.reset(model_.clone());
+        if (!stream->asr)
+        {
+            return false;
+        }
+        streams_.push_back(std::move(stream));
+    }
+    // chunk boundaries of the streams are spread over one chunk
+    for (int i = 0; i < count; i++)
+    {
+        auto& stream = *streams_[i];
+        stream.asr->begin_stream(sample_rate_);
+        stream.offset_ms = chunk_ms_ * i / count;
+        stream.position = 0;
+        stream.completed = stream.processed = 0;
+        stream.queued = false;
+    }
+    stop_ = false;
+    dropped_ = 0;
+    start_ = Clock::now();
+    std::vector<std::vector<double>> latency(workers_);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers_; i++)
+    {
+        threads.emplace_back(&LoadTest::work, this, std::ref(latency[i]));
+    }
+    // producer: every 10ms each stream receives the audio that has "arrived" by now
+    while (true)
+    {
+        double now_ms = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+        if (now_ms >= seconds * 1000)
+        {
+            break;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            auto& stream = *streams_[i];
+            double audio_ms = std::max(0.0, now_ms - stream.offset_ms);
+            feed(stream, static_cast<size_t>(audio_ms * sample_rate_ / 1000));
+            long completed = static_cast<long>(stream.position / chunk_);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (completed > stream.completed)
+            {
+                stream.completed = completed;
+                if (!stream.queued)
+                {
+                    stream.queued = true;
+                    queue_.push_back(&stream);
+                    cv_.notify_one();
+                }
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        queue_.clear();
+    }
+    cv_.notify_all();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<double> all;
+    for (const auto& values : latency)
+    {
+        all.insert(all.end(), values.begin(), values.end());
+    }
+    // chunks still waiting at the end count as late as the trial is long
+    for (int i = 0; i < count; i++)
+    {
+        for (long k = streams_[i]->processed; k < streams_[i]->completed; k++)
+        {
+            all.push_back(seconds * 1000 - streams_[i]->offset_ms - (k + 1) * chunk_ms_);
+        }
+    }
+    std::sort(all.begin(), all.end());
+    auto rank = [&](double p)
+    {
+        return all.empty() ? 0.0 : all[std::max<size_t>(static_cast<size_t>(std::ceil(p * all.size())), 1) - 1];
+    };
+    trial.streams = count;
+    trial.chunks = static_cast<long>(all.size());
+    trial.p50 = rank(0.5);
+    trial.p90 = rank(0.9);
+    trial.p99 = rank(0.99);
+    trial.dropped = static_cast<long>(dropped_);
+    return true;
+}
+
+void LoadTest::work(std::vector<double>& latency)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (stop_)
+        {
+            return;
+        }
+        Stream* stream = queue_.front();
+        queue_.pop_front();
+        long ready = stream->completed;
+        lock.unlock();
+
+        stream->asr->recognize_pending();
+        double done_ms = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+        // from the moment the chunk's last sample arrived to its text
+        for (long k = stream->processed; k < ready; k++)
+        {
+            latency.push_back(done_ms - stream->offset_ms - (k + 1) * chunk_ms_);
+        }
+        stream->processed = ready;
+
+        lock.lock();
+        if (stream->completed > ready && !stop_)
+        {
+            queue_.push_back(stream);
+        }
+        else
+        {
+            stream->queued = false;
+        }
+    }
+}
+
+static std::string trial_json(const Trial& trial)
+{
+    std::ostringstream json;
+    json << "{\"streams\": " << trial.streams << ", \"chunks\": " << trial.chunks
+         << ", \"p50_ms\": " << trial.p50 << ", \"p90_ms\": " << trial.p90 << ", \"p99_ms\": " << trial.p99
+         << ", \"dropped_samples\": " << trial.dropped << "}";
+    return json.str();
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 3)
+    {
+        Help();
+        return 0;
+    }
+    std::string config_path = argv[1];
+    std::string wav_file = argv[2];
+    double target = argc > 3 ? std::atof(argv[3]) : 300;
+    int workers = argc > 4 ? std::max(1, std::atoi(argv[4])) : std::max(1u, std::thread::hardware_concurrency());
+    double seconds = argc > 5 ? std::max(1.0, std::atof(argv[5])) : 20;
+    int max_streams = argc > 6 ? std::max(1, std::atoi(argv[6])) : 256;
+    std::string report_path = argc > 7 ? argv[7] : "";
+
+    std::shared_ptr<SR::AsrConfig> config(new SR::AsrConfig(config_path));
+    std::unique_ptr<SR::Asr> asr(new SR::Asr(config));
+    if (!asr->load())
+    {
+        return 1;
+    }
+    asr->warmup();
+    auto audio = MNN::AUDIO::load(wav_file);
+    if (audio.first.get() == nullptr || audio.second <= 0)
+    {
+        ERROR_PRINT("Error: failed to load wav: " + wav_file);
+        return 1;
+    }
+    int sample_rate = audio.second;
+    int chunk = config->chunk_size()[1] * config->lfr_n() * config->frame_shift_ms() * sample_rate / 1000;
+    LoadTest test(*asr, audio.first->readMap<float>(), audio.first->getInfo()->size, sample_rate, chunk, workers);
+
+    // double the streams until the target is missed, then bisect between the last two
+    std::vector<Trial> trials;
+    auto passes = [&](int count)
+    {
+        Trial trial;
+        if (!test.run(count, seconds, trial))
+        {
+            ERROR_PRINT("Error: failed to clone streams");
+            return false;
+        }
+        trials.push_back(trial);
+        INFO_PRINT(trial_json(trial));
+        return trial.p99 <= target && trial.dropped == 0;
+    };
+    int good = 0, bad = max_streams + 1;
+    for (int count = 1; count <= max_streams; count = std::min(count * 2, max_streams))
+    {
+        if (!passes(count))
+        {
+            bad = count;
+            break;
+        }
+        good = count;
+        if (count == max_streams)
+        {
+            break;
+        }
+    }
+    while (bad - good > 1 && good < max_streams)
+    {
+        int count = (good + bad) / 2;
+        if (passes(count))
+        {
+            good = count;
+        }
+        else
+        {
+            bad = count;
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\"wav\": \"" << wav_file << "\", \"p99_target_ms\": " << target << ", \"workers\": " << workers
+         << ", \"seconds\": " << seconds << ", \"max_streams\": " << good << ", \"trials\": [";
+    for (size_t i = 0; i < trials.size(); i++)
+    {
+        json << (i ? ", " : "") << trial_json(trials[i]);
+    }
+    json << "]}";
+    LOG_PRINT(json.str());
+    if (!report_path.empty())
+    {
+        std::ofstream(report_path) << json.str() << std::endl;
+        INFO_PRINT("✓ Report saved to: " + report_path);
+    }
+    return 0;
+}
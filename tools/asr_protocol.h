@@ -0,0 +1,119 @@
+//
+//  asr_protocol.h
+//
+//  Created by smart on 2026/10/18.
+//
+
+#ifndef ASR_PROTOCOL_H
+#define ASR_PROTOCOL_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <unistd.h>
+
+// length-prefixed binary frames, integers and samples are little endian:
+//   uint32 payload size | uint8 type | payload
+// a connection carries one stream at a time:
+//   client: BEGIN (int32 sample rate), AUDIO (int16 pcm)..., END
+//   server: PARTIAL (utf-8 text decoded since the last frame)..., FINAL (the rest of the text)
+// the next BEGIN is sent after FINAL; ERROR carries a message and is followed by a close.
+// a producer on the same host sends ATTACH (shared memory ring name) instead of BEGIN and
+// writes the pcm into a PcmRing::create_shared() ring, finish() on the ring ends the stream
+namespace SR
+{
+namespace protocol
+{
+    enum FrameType : uint8_t
+    {
+        FRAME_BEGIN = 1,
+        FRAME_AUDIO = 2,
+        FRAME_END = 3,
+        FRAME_ATTACH = 4,
+        FRAME_PARTIAL = 16,
+        FRAME_FINAL = 17,
+        FRAME_ERROR = 18,
+    };
+
+    static constexpr size_t HEADER_SIZE = 5;
+    static constexpr uint32_t MAX_PAYLOAD = 1 << 20;
+
+    inline std::string frame(uint8_t type, const void* payload, uint32_t size)
+    {
+        std::string out(HEADER_SIZE + size, '\0');
+        ::memcpy(&out[0], &size, 4);
+        out[4] = static_cast<char>(type);
+        if (size)
+        {
+            ::memcpy(&out[HEADER_SIZE], payload, size);
+        }
+        return out;
+    }
+
+    inline std::string frame(uint8_t type, const std::string& payload)
+    {
+        return frame(type, payload.data(), static_cast<uint32_t>(payload.size()));
+    }
+
+    // a complete frame at the front of `buffer`, -1 when the payload size is invalid
+    inline int parse(const std::string& buffer, uint8_t& type, uint32_t& size)
+    {
+        if (buffer.size() < HEADER_SIZE)
+        {
+            return 0;
+        }
+        ::memcpy(&size, buffer.data(), 4);
+        if (size > MAX_PAYLOAD)
+        {
+            return -1;
+        }
+        type = static_cast<uint8_t>(buffer[4]);
+        return buffer.size() >= HEADER_SIZE + size ? 1 : 0;
+    }
+
+    // `unix:/path/to.sock` or `host:port`, returns a socket of the address family and fills `addr`
+    inline int address(const std::string& target, sockaddr_storage& addr, socklen_t& length)
+    {
+        ::memset(&addr, 0, sizeof(addr));
+        if (target.compare(0, 5, "unix:") == 0)
+        {
+            auto un = reinterpret_cast<sockaddr_un*>(&addr);
+            std::string path = target.substr(5);
+            if (path.size() >= sizeof(un->sun_path))
+            {
+                return -1;
+            }
+            un->sun_family = AF_UNIX;
+            ::strncpy(un->sun_path, path.c_str(), sizeof(un->sun_path) - 1);
+            length = sizeof(sockaddr_un);
+            return ::socket(AF_UNIX, SOCK_STREAM, 0);
+        }
+        size_t pos = target.rfind(':');
+        if (pos == std::string::npos)
+        {
+            return -1;
+        }
+        std::string host = target.substr(0, pos), port = target.substr(pos + 1);
+        addrinfo hints, *result = nullptr;
+        ::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0 || !result)
+        {
+            return -1;
+        }
+        ::memcpy(&addr, result->ai_addr, result->ai_addrlen);
+        length = result->ai_addrlen;
+        int fd = ::socket(result->ai_family, SOCK_STREAM, 0);
+        ::freeaddrinfo(result);
+        return fd;
+    }
+}
+}
+
+#endif // ASR_PROTOCOL_H
@@ -0,0 +1,711 @@
+//
+//  asr_server.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asr.hpp"
+#include "asrregistry.hpp"
+#include "asr_protocol.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <csignal>
+#include <cerrno>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <condition_variable>
+#include <unordered_map>
+#include "utils/utils.h"
+#include "utils/metrics.h"
+
+using namespace SR::protocol;
+
+void Help()
+{
+    ERROR_PRINT("please input: ");
+    INFO_PRINT("\tconfig.json");
+    INFO_PRINT("\tlisten address, unix:/path/to.sock or host:port");
+    INFO_PRINT("\t[workers], default is 4");
+    INFO_PRINT("\t[metrics.prom], prometheus text rewritten every 10s");
+    INFO_PRINT("\t[memory budget MB], streams beyond it are rejected, default is 0 (no limit)");
+    INFO_PRINT("SIGHUP reloads the models of config.json, streams in progress finish on the old ones");
+}
+
+static volatile std::sig_atomic_t reload_signal = 0;
+// the event loop's eventfd, the signal may arrive on any thread
+static int reload_notify_fd = -1;
+
+static void on_reload_signal(int)
+{
+    reload_signal = 1;
+    if (reload_notify_fd >= 0)
+    {
+        uint64_t one = 1;
+        ssize_t ignored = ::write(reload_notify_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+// one connection: the event loop owns the socket and feeds pcm into the stream's lock-free
+// ring, a worker runs recognition on the session's Asr clone and queues text in `outbox`
+struct Session
+{
+    int fd = -1;
+    // the model `asr` is cloned from, kept alive until the next stream moves to a reloaded one
+    std::shared_ptr<SR::Asr> model;
+    std::unique_ptr<SR::Asr> asr;
+    // event loop only
+    std::string inbox;
+    std::vector<float> pending;
+    bool streaming = false;
+    // pcm comes through a shared memory ring, polled by the event loop
+    bool shared = false;
+    bool paused = false;
+    bool writing = false;
+    // shared with the workers
+    std::mutex mutex;
+    std::string outbox;
+    bool queued = false;
+    bool dirty = false;
+    bool closed = false;
+};
+
+class Server
+{
+public:
+    Server(const std::string& config_path, int workers, size_t memory_budget = 0)
+        : config_path_(config_path), workers_(workers), memory_budget_(memory_budget) {}
+    // the current model of the config, loaded on the first call, nullptr when loading fails
+    std::shared_ptr<SR::Asr> model();
+    bool listen(const std::string& target);
+    void run();
+    // sessions, queue depth and model memory sampled into the metrics before every export
+    void collect_metrics();
+private:
+    void reload();
+    bool switch_model(const std::shared_ptr<Session>& session);
+    bool admit(const std::shared_ptr<Session>& session);
+    void accept_clients();
+    void on_readable(const std::shared_ptr<Session>& session);
+    void on_writable(const std::shared_ptr<Session>& session);
+    void on_notify();
+    void poll_shared();
+    bool pump(const std::shared_ptr<Session>& session);
+    void update_events(const std::shared_ptr<Session>& session);
+    void close_session(const std::shared_ptr<Session>& session);
+    void send(const std::shared_ptr<Session>& session, const std::string& data);
+    void schedule(const std::shared_ptr<Session>& session);
+    void work();
+private:
+    std::string config_path_;
+    // new sessions and streams clone the current model of the registry, reload() replaces it
+    SR::AsrRegistry registry_;
+    std::thread reload_thread_;
+    std::atomic<bool> reloading_{false};
+    int workers_;
+    size_t memory_budget_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int notify_fd_ = -1;
+    std::string unix_path_;
+    std::unordered_map<int, std::shared_ptr<Session>> sessions_;
+    int shared_ = 0;
+    // sessions waiting for a worker
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    // workers exit once the queue is drained
+    bool stop_ = false;
+    std::deque<std::shared_ptr<Session>> queue_;
+    // sessions a worker finished with, handed back to the event loop through notify_fd_
+    std::mutex notify_mutex_;
+    std::vector<std::shared_ptr<Session>> notified_;
+};
+
+static bool set_nonblocking(int fd)
+{
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool Server::listen(const std::string& target)
+{
+    sockaddr_storage addr;
+    socklen_t length = 0;
+    listen_fd_ = address(target, addr, length);
+    if (listen_fd_ < 0)
+    {
+        ERROR_PRINT("Error: invalid listen address: " + target);
+        return false;
+    }
+    if (addr.ss_family == AF_UNIX)
+    {
+        unix_path_ = target.substr(5);
+        ::unlink(unix_path_.c_str());
+    }
+    else
+    {
+        int reuse = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), length) != 0 || ::listen(listen_fd_, 128) != 0)
+    {
+        ERROR_PRINT("Error: unable to listen on: " + target);
+        return false;
+    }
+    set_nonblocking(listen_fd_);
+    epoll_fd_ = ::epoll_create1(0);
+    notify_fd_ = ::eventfd(0, EFD_NONBLOCK);
+    reload_notify_fd = notify_fd_;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd_;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+    event.data.fd = notify_fd_;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, notify_fd_, &event);
+    INFO_PRINT("✓ listening on " + target);
+    return true;
+}
+
+void Server::run()
+{
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers_; i++)
+    {
+        threads.emplace_back(&Server::work, this);
+    }
+    std::vector<epoll_event> events(256);
+    while (true)
+    {
+        // shared memory producers don't signal, their rings are polled every 10ms
+        int count = ::epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), shared_ ? 10 : -1);
+        if (count < 0 && errno != EINTR)
+        {
+            break;
+        }
+        if (reload_signal)
+        {
+            reload_signal = 0;
+            reload();
+        }
+        poll_shared();
+        for (int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_)
+            {
+                accept_clients();
+                continue;
+            }
+            if (fd == notify_fd_)
+            {
+                on_notify();
+                continue;
+            }
+            auto it = sessions_.find(fd);
+            if (it == sessions_.end())
+            {
+                continue;
+            }
+            auto session = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                close_session(session);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT)
+            {
+                on_writable(session);
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP))
+            {
+                on_readable(session);
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stop_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (reload_thread_.joinable())
+    {
+        reload_thread_.join();
+    }
+}
+
+std::shared_ptr<SR::Asr> Server::model()
+{
+    return registry_.acquire(config_path_);
+}
+
+// the registry loads and warms up the models in the background, then new streams switch to them
+void Server::reload()
+{
+    if (reloading_.exchange(true))
+    {
+        return;
+    }
+    // the previous reload is done
+    if (reload_thread_.joinable())
+    {
+        reload_thread_.join();
+    }
+    INFO_PRINT("reloading models of " + config_path_);
+    reload_thread_ = std::thread([this]()
+    {
+        if (!registry_.reload(config_path_))
+        {
+            ERROR_PRINT("Error: reload failed, keeping the current models");
+        }
+        reloading_ = false;
+    });
+}
+
+// before a stream begins, the session moves to the current model when it was reloaded
+bool Server::switch_model(const std::shared_ptr<Session>& session)
+{
+    auto model = this->model();
+    if (!model)
+    {
+        return false;
+    }
+    if (session->asr && session->model == model)
+    {
+        return true;
+    }
+    // clones share the weights, each connection keeps its own stream state
+    std::unique_ptr<SR::Asr> asr(model->clone());
+    if (!asr)
+    {
+        return false;
+    }
+    session->asr = std::move(asr);
+    session->model = model;
+    return true;
+}
+
+void Server::accept_clients()
+{
+    while (true)
+    {
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0)
+        {
+            return;
+        }
+        set_nonblocking(fd);
+        std::shared_ptr<Session> session(new Session);
+        session->fd = fd;
+        if (!switch_model(session))
+        {
+            ::close(fd);
+            continue;
+        }
+        sessions_[fd] = session;
+        Metrics::global().gauge("asr_sessions_active", "Open streaming sessions").add(1);
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+        DEBUG_PRINT("client connected: " + std::to_string(fd));
+    }
+}
+
+void Server::on_readable(const std::shared_ptr<Session>& session)
+{
+    char buffer[16384];
+    while (!session->paused)
+    {
+        ssize_t size = ::recv(session->fd, buffer, sizeof(buffer), 0);
+        if (size == 0 || (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            close_session(session);
+            return;
+        }
+        if (size < 0)
+        {
+            break;
+        }
+        session->inbox.append(buffer, size);
+        if (!pump(session))
+        {
+            return;
+        }
+    }
+    update_events(session);
+}
+
+// parse complete frames; stops (paused) when the ring is full or a new stream has to wait for
+// the worker, returns false when the session was closed
+bool Server::pump(const std::shared_ptr<Session>& session)
+{
+    session->paused = false;
+    while (true)
+    {
+        if (!session->pending.empty())
+        {
+            size_t fed = session->asr->feed(session->pending.data(), session->pending.size());
+            session->pending.erase(session->pending.begin(), session->pending.begin() + fed);
+            if (fed)
+            {
+                schedule(session);
+            }
+            if (!session->pending.empty())
+            {
+                // backpressure: stop reading until the worker drained the ring
+                session->paused = true;
+                return true;
+            }
+        }
+        uint8_t type = 0;
+        uint32_t size = 0;
+        int status = parse(session->inbox, type, size);
+        if (status == 0)
+        {
+            return true;
+        }
+        const char* payload = session->inbox.data() + HEADER_SIZE;
+        if (status < 0)
+        {
+            send(session, frame(FRAME_ERROR, "frame too large"));
+            close_session(session);
+            return false;
+        }
+        if (type == FRAME_BEGIN || type == FRAME_ATTACH)
+        {
+            {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                if (session->queued)
+                {
+                    session->paused = true;
+                    return true;
+                }
+            }
+            shared_ -= session->shared;
+            session->shared = false;
+            if (!switch_model(session))
+            {
+                send(session, frame(FRAME_ERROR, "unable to clone the model"));
+                close_session(session);
+                return false;
+            }
+            if (type == FRAME_ATTACH)
+            {
+                if (!session->asr->attach_stream(std::string(payload, size)))
+                {
+                    send(session, frame(FRAME_ERROR, "unable to map shared memory ring"));
+                    close_session(session);
+                    return false;
+                }
+                session->shared = true;
+                shared_++;
+            }
+            else
+            {
+                int32_t sample_rate = 16000;
+                if (size >= 4)
+                {
+                    ::memcpy(&sample_rate, payload, 4);
+                }
+                // the ring and the resampler are sized by the rate
+                if (!sample_rate || !session->asr->begin_stream(sample_rate))
+                {
+                    send(session, frame(FRAME_ERROR, "unsupported sample rate " + std::to_string(sample_rate)));
+                    close_session(session);
+                    return false;
+                }
+                session->streaming = true;
+            }
+            if (!admit(session))
+            {
+                send(session, frame(FRAME_ERROR, "memory budget exceeded"));
+                close_session(session);
+                return false;
+            }
+        }
+        else if (type == FRAME_AUDIO && session->streaming)
+        {
+            // little endian byte pairs, the payload sits at an odd offset in the inbox
+            auto bytes = reinterpret_cast<const uint8_t*>(payload);
+            for (uint32_t i = 0; i < size / 2; i++)
+            {
+                auto sample = static_cast<int16_t>(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+                session->pending.push_back(sample / 32768.f);
+            }
+        }
+        else if (type == FRAME_END && session->streaming)
+        {
+            session->streaming = false;
+            session->asr->end_stream();
+            schedule(session);
+        }
+        else
+        {
+            send(session, frame(FRAME_ERROR, "unexpected frame type " + std::to_string(type)));
+            close_session(session);
+            return false;
+        }
+        session->inbox.erase(0, HEADER_SIZE + size);
+    }
+}
+
+// every connection keeps the stream state of its clone, the runtime holds the weights and
+// the workspace of all of them: admit while the stream's high-water mark plus the state of
+// the other connections fits the budget
+bool Server::admit(const std::shared_ptr<Session>& session)
+{
+    if (!memory_budget_)
+    {
+        return true;
+    }
+    auto memory = session->asr->memory();
+    // the shared runtime plus what every open stream (this one included) was measured to take
+    size_t used = memory.runtime + sessions_.size() * memory.stream;
+    if (used > memory_budget_)
+    {
+        WARNING_PRINT("Warning: stream rejected, needs " + std::to_string(used / (1024 * 1024)) + "MB of a budget of " +
+                      std::to_string(memory_budget_ / (1024 * 1024)) + "MB");
+        return false;
+    }
+    return true;
+}
+
+void Server::update_events(const std::shared_ptr<Session>& session)
+{
+    if (session->closed)
+    {
+        return;
+    }
+    epoll_event event{};
+    event.events = (session->paused ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP)) |
+                   (session->writing ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.fd = session->fd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, session->fd, &event);
+}
+
+void Server::send(const std::shared_ptr<Session>& session, const std::string& data)
+{
+    std::lock_guard<std::mutex> lock(session->mutex);
+    session->outbox += data;
+}
+
+void Server::on_writable(const std::shared_ptr<Session>& session)
+{
+    std::lock_guard<std::mutex> lock(session->mutex);
+    if (session->closed)
+    {
+        return;
+    }
+    while (!session->outbox.empty())
+    {
+        ssize_t size = ::send(session->fd, session->outbox.data(), session->outbox.size(), MSG_NOSIGNAL);
+        if (size <= 0)
+        {
+            break;
+        }
+        session->outbox.erase(0, size);
+    }
+    session->writing = !session->outbox.empty();
+}
+
+void Server::on_notify()
+{
+    uint64_t value = 0;
+    ssize_t ignored = ::read(notify_fd_, &value, sizeof(value));
+    (void)ignored;
+    std::vector<std::shared_ptr<Session>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(notify_mutex_);
+        sessions.swap(notified_);
+    }
+    for (auto& session : sessions)
+    {
+        if (session->closed)
+        {
+            continue;
+        }
+        on_writable(session);
+        if (session->paused && !pump(session))
+        {
+            continue;
+        }
+        update_events(session);
+        // frames may have been read before the pause was lifted
+        if (!session->paused)
+        {
+            on_readable(session);
+        }
+    }
+}
+
+void Server::poll_shared()
+{
+    if (!shared_)
+    {
+        return;
+    }
+    for (auto& it : sessions_)
+    {
+        auto& session = it.second;
+        if (!session->shared)
+        {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->queued)
+            {
+                continue;
+            }
+        }
+        // idle sessions are only scheduled from this thread, the stream can't change under us
+        if (session->asr->stream_ready())
+        {
+            schedule(session);
+        }
+    }
+}
+
+void Server::close_session(const std::shared_ptr<Session>& session)
+{
+    if (session->closed)
+    {
+        return;
+    }
+    shared_ -= session->shared;
+    session->shared = false;
+    on_writable(session);
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->closed = true;
+    }
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session->fd, nullptr);
+    ::close(session->fd);
+    sessions_.erase(session->fd);
+    Metrics::global().gauge("asr_sessions_active", "Open streaming sessions").add(-1);
+    DEBUG_PRINT("client closed: " + std::to_string(session->fd));
+}
+
+void Server::collect_metrics()
+{
+    auto& metrics = Metrics::global();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        metrics.gauge("asr_queue_depth", "Items waiting for a worker", "queue=\"server\"").set(queue_.size());
+    }
+    float mb = 0.f;
+    auto model = this->model();
+    auto runtime = model ? model->runtime_manager() : nullptr;
+    if (runtime && runtime->getInfo(MNN::Interpreter::MEMORY, &mb))
+    {
+        metrics.gauge("asr_memory_bytes", "Memory of the model runtime").set(mb * 1024.0 * 1024.0);
+    }
+}
+
+void Server::schedule(const std::shared_ptr<Session>& session)
+{
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->dirty = true;
+        if (session->queued)
+        {
+            return;
+        }
+        session->queued = true;
+    }
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queue_.push_back(session);
+    queue_cv_.notify_one();
+}
+
+void Server::work()
+{
+    while (true)
+    {
+        std::shared_ptr<Session> session;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty())
+            {
+                return;
+            }
+            session = queue_.front();
+            queue_.pop_front();
+        }
+        // run until no pcm arrived during the last pass, a session is on one worker at a time
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                session->dirty = false;
+                if (session->closed)
+                {
+                    session->queued = false;
+                    break;
+                }
+            }
+            bool stream_end = false;
+            auto text = session->asr->recognize_pending(&stream_end);
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (!text.empty() || stream_end)
+            {
+                session->outbox += frame(stream_end ? FRAME_FINAL : FRAME_PARTIAL, text);
+            }
+            if (!session->dirty)
+            {
+                session->queued = false;
+                break;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(notify_mutex_);
+            notified_.push_back(session);
+        }
+        uint64_t one = 1;
+        ssize_t ignored = ::write(notify_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 3)
+    {
+        Help();
+        return 0;
+    }
+    std::string config_path = argv[1];
+    std::string target = argv[2];
+    int workers = argc > 3 ? std::max(1, std::atoi(argv[3])) : 4;
+    std::string metrics_path = argc > 4 ? argv[4] : "";
+    size_t memory_budget = argc > 5 ? static_cast<size_t>(std::max(0, std::atoi(argv[5]))) << 20 : 0;
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGHUP, on_reload_signal);
+
+    Server server(config_path, workers, memory_budget);
+    auto asr = server.model();
+    if (!asr)
+    {
+        return 1;
+    }
+    asr->warmup();
+    if (!server.listen(target))
+    {
+        return 1;
+    }
+    if (!metrics_path.empty())
+    {
+        Metrics::global().on_collect([&server]() { server.collect_metrics(); });
+        Metrics::global().start_writer(metrics_path, 10000);
+    }
+    server.run();
+    return 0;
+}
@@ -0,0 +1,203 @@
+//
+//  bench_asr.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asr.hpp"
+#include "asrconfig.hpp"
+#include <audio/audio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "utils/utils.h"
+
+// every operator new of the process, MNN's graph building included
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void Help()
+{
+    ERROR_PRINT("please input: ");
+    INFO_PRINT("\tconfig.json");
+    INFO_PRINT("\t[wav], default is ../resource/audio.wav");
+    INFO_PRINT("\t[iterations], streaming passes over the wav, default is 20");
+    INFO_PRINT("\t[report.json]");
+    INFO_PRINT("\t[ops], 1 adds a pass with per operator profiling to the report, default is 0");
+}
+
+static const char* STAGES[] = {"resample", "fbank", "lfr_cmvn", "position_encoding",
+                               "encoder", "cif", "decoder", "detokenize"};
+static constexpr int STAGE_NUM = sizeof(STAGES) / sizeof(STAGES[0]);
+
+// nearest rank percentile
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+
+static std::string summary(const std::vector<double>& values)
+{
+    std::ostringstream json;
+    json << "{\"p50\": " << percentile(values, 0.5) << ", \"p90\": " << percentile(values, 0.9)
+         << ", \"p99\": " << percentile(values, 0.99) << ", \"max\": " << percentile(values, 1.0) << "}";
+    return json.str();
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 2)
+    {
+        Help();
+        return 0;
+    }
+    std::string config_path = argv[1];
+    std::string wav_file = argc > 2 ? argv[2] : "../resource/audio.wav";
+    int iterations = argc > 3 ? std::max(1, std::atoi(argv[3])) : 20;
+    std::string report_path = argc > 4 ? argv[4] : "";
+    bool profile_ops = argc > 5 && std::atoi(argv[5]) != 0;
+
+    std::shared_ptr<SR::AsrConfig> config(new SR::AsrConfig(config_path));
+    std::unique_ptr<SR::Asr> asr(new SR::Asr(config));
+    if (!asr->load())
+    {
+        return 1;
+    }
+    auto audio = MNN::AUDIO::load(wav_file);
+    if (audio.first.get() == nullptr || audio.second <= 0)
+    {
+        ERROR_PRINT("Error: failed to load wav: " + wav_file);
+        return 1;
+    }
+    int sample_rate = audio.second;
+    auto pcm = audio.first->readMap<float>();
+    int samples = audio.first->getInfo()->size;
+    // the streaming chunk at the wav's rate, as recognize_pending() feeds it
+    int chunk = config->chunk_size()[1] * config->lfr_n() * config->frame_shift_ms() * sample_rate / 1000;
+    double chunk_ms = 1000.0 * chunk / sample_rate;
+
+    std::vector<double> stage_ms[STAGE_NUM];
+    double chunk_stage[STAGE_NUM];
+    asr->set_stage_callback([&](const char* stage, double ms)
+    {
+        for (int i = 0; i < STAGE_NUM; i++)
+        {
+            if (std::strcmp(stage, STAGES[i]) == 0)
+            {
+                chunk_stage[i] += ms;
+            }
+        }
+    });
+    asr->warmup();
+
+    std::vector<double> latency, rtf, allocs;
+    std::string text;
+    for (int iter = 0; iter < iterations; iter++)
+    {
+        asr->begin_stream(sample_rate);
+        text.clear();
+        for (int offset = 0; offset < samples; offset += chunk)
+        {
+            int size = std::min(chunk, samples - offset);
+            bool is_final = offset + size >= samples;
+            std::fill(chunk_stage, chunk_stage + STAGE_NUM, 0.0);
+            size_t before = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            auto speech = MNN::Express::_Const(pcm + offset, {size}, MNN::Express::NHWC, halide_type_of<float>());
+            text += asr->recognize(speech, is_final);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            allocs.push_back(static_cast<double>(allocations.load(std::memory_order_relaxed) - before));
+            latency.push_back(ms);
+            rtf.push_back(ms / chunk_ms);
+            for (int i = 0; i < STAGE_NUM; i++)
+            {
+                stage_ms[i].push_back(chunk_stage[i]);
+            }
+        }
+    }
+
+    // op callbacks slow every op down, profile in a pass of its own on a clone with its own
+    // executor
+    std::string ops;
+    std::unique_ptr<SR::Asr> profiled(profile_ops ? asr->clone() : nullptr);
+    if (profiled && profiled->set_op_profiling(true))
+    {
+        profiled->begin_stream(sample_rate);
+        for (int offset = 0; offset < samples; offset += chunk)
+        {
+            int size = std::min(chunk, samples - offset);
+            profiled->recognize(MNN::Express::_Const(pcm + offset, {size}, MNN::Express::NHWC,
+                                                     halide_type_of<float>()),
+                                offset + size >= samples);
+        }
+        LOG_PRINT("\n" + profiled->op_profile());
+        ops = profiled->op_profile(50, true);
+        profiled->set_op_profiling(false);
+    }
+
+    std::ostringstream json;
+    json << "{\"wav\": \"" << wav_file << "\", \"iterations\": " << iterations
+         << ", \"chunks\": " << latency.size() << ", \"chunk_ms\": " << chunk_ms
+         << ", \"latency_ms\": " << summary(latency) << ", \"rtf\": " << summary(rtf)
+         << ", \"allocations\": " << summary(allocs) << ", \"stages_ms\": {";
+    for (int i = 0; i < STAGE_NUM; i++)
+    {
+        json << (i ? ", " : "") << "\"" << STAGES[i] << "\": " << summary(stage_ms[i]);
+    }
+    json << "}";
+    // model and per stream memory after the runs, peak over all of them
+    auto memory = asr->memory();
+    auto parts = [&](const std::vector<std::pair<std::string, size_t>>& parts)
+    {
+        json << "{";
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            json << (i ? ", " : "") << "\"" << parts[i].first << "\": " << parts[i].second;
+        }
+        json << "}";
+    };
+    json << ", \"memory\": {\"weights\": ";
+    parts(memory.weights);
+    json << ", \"runtime\": " << memory.runtime << ", \"workspace\": " << memory.workspace << ", \"session\": ";
+    parts(memory.session);
+    json << ", \"session_total\": " << memory.session_total << ", \"peak\": " << memory.peak
+         << ", \"stream\": " << memory.stream << "}";
+    if (!ops.empty())
+    {
+        json << ", \"ops\": " << ops;
+    }
+    json << "}";
+
+    LOG_PRINT(text);
+    LOG_PRINT(json.str());
+    if (!report_path.empty())
+    {
+        std::ofstream(report_path) << json.str() << std::endl;
+        INFO_PRINT("✓ Report saved to: " + report_path);
+    }
+    return 0;
+}
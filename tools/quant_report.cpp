@@ -0,0 +1,208 @@
+//
+//  quant_report.cpp
+//
+//  Created by smart on 2026/10/18.
+//
+
+#include "asr.hpp"
+#include "asrconfig.hpp"
+#include <audio/audio.hpp>
+#include "utils/utils.h"
+#include "utils/timer.h"
+
+struct Sample
+{
+    std::string wav;
+    std::string text;
+};
+
+struct Report
+{
+    std::string variant;
+    double model_mb = 0;
+    double load_ms = 0;
+    double audio_s = 0;
+    double infer_ms = 0;
+    std::vector<std::string> hyps;
+};
+
+void Help()
+{
+    ERROR_PRINT("please input: ");
+    INFO_PRINT("\tconfig.json");
+    INFO_PRINT("\ttest_set.txt, one `wav_path [transcript]` per line");
+    INFO_PRINT("\t[weight_quant], default is int8");
+    INFO_PRINT("\t[report.json]");
+}
+
+// `wav_path transcript` per line, relative wav paths are resolved against the test set
+static std::vector<Sample> load_test_set(const std::string& path)
+{
+    std::vector<Sample> samples;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        size_t pos = line.find_first_of(" \t");
+        Sample sample;
+        sample.wav = line.substr(0, pos);
+        if (pos != std::string::npos)
+        {
+            sample.text = line.substr(pos + 1);
+        }
+        if (sample.wav[0] != '/')
+        {
+            sample.wav = SR::base_dir(path) + sample.wav;
+        }
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+// utf-8 characters without whitespace, ascii is lower-cased
+static std::vector<std::string> utf8_chars(const std::string& text)
+{
+    std::vector<std::string> chars;
+    for (size_t i = 0; i < text.size();)
+    {
+        unsigned char c = text[i];
+        size_t len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3 : 4;
+        if (!std::isspace(c))
+        {
+            chars.push_back(c < 0x80 ? std::string(1, std::tolower(c)) : text.substr(i, len));
+        }
+        i += len;
+    }
+    return chars;
+}
+
+static int edit_distance(const std::vector<std::string>& hyp, const std::vector<std::string>& ref)
+{
+    std::vector<int> prev(ref.size() + 1), curr(ref.size() + 1);
+    for (size_t j = 0; j <= ref.size(); j++)
+    {
+        prev[j] = j;
+    }
+    for (size_t i = 1; i <= hyp.size(); i++)
+    {
+        curr[0] = i;
+        for (size_t j = 1; j <= ref.size(); j++)
+        {
+            int sub = prev[j - 1] + (hyp[i - 1] == ref[j - 1] ? 0 : 1);
+            curr[j] = std::min(sub, std::min(prev[j], curr[j - 1]) + 1);
+        }
+        std::swap(prev, curr);
+    }
+    return prev[ref.size()];
+}
+
+// character error rate of `hyps` against `refs`, -1 when there is no reference text
+static double cer(const std::vector<std::string>& hyps, const std::vector<std::string>& refs)
+{
+    long errors = 0, total = 0;
+    for (size_t i = 0; i < hyps.size(); i++)
+    {
+        auto ref = utf8_chars(refs[i]);
+        errors += edit_distance(utf8_chars(hyps[i]), ref);
+        total += ref.size();
+    }
+    return total > 0 ? static_cast<double>(errors) / total : -1;
+}
+
+static double file_mb(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file.is_open() ? file.tellg() / 1024.0 / 1024.0 : 0;
+}
+
+static bool run_variant(const std::string& config_path, const std::string& quant,
+                        const std::vector<Sample>& samples, Report& report)
+{
+    std::shared_ptr<SR::AsrConfig> config(new SR::AsrConfig(config_path));
+    config->config_.merge(("{\"weight_quant\": \"" + quant + "\"}").c_str());
+    report.variant = quant.empty() ? "float" : quant;
+    report.model_mb = file_mb(config->encoder_model()) + file_mb(config->decoder_model());
+
+    std::unique_ptr<SR::Asr> asr(new SR::Asr(config));
+    Timer timer;
+    if (!asr->load())
+    {
+        ERROR_PRINT("Error: Failed to load " + report.variant + " model");
+        return false;
+    }
+    report.load_ms = timer.Timing();
+
+    for (const auto& sample : samples)
+    {
+        // loaded outside the timed region, the rtf is recognition only
+        auto audio = MNN::AUDIO::load(sample.wav);
+        if (!audio.first.get() || audio.second <= 0)
+        {
+            // an empty hypothesis keeps the references aligned, it counts as errors
+            WARNING_PRINT("Warning: unable to read " + sample.wav);
+            report.hyps.push_back("");
+            continue;
+        }
+        report.audio_s += static_cast<double>(audio.first->getInfo()->size) / audio.second;
+        timer.Timing();
+        report.hyps.push_back(asr->online_recognize(audio.first, audio.second));
+        report.infer_ms += timer.Timing();
+    }
+    return true;
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 3)
+    {
+        Help();
+        return 0;
+    }
+    std::string config_path = argv[1];
+    auto samples = load_test_set(argv[2]);
+    std::string quant = argc > 3 ? argv[3] : "int8";
+    std::string report_path = argc > 4 ? argv[4] : "";
+    if (samples.empty())
+    {
+        ERROR_PRINT("Error: empty test set: " + std::string(argv[2]));
+        return 1;
+    }
+
+    Report reports[2];
+    if (!run_variant(config_path, "", samples, reports[0]) ||
+        !run_variant(config_path, quant, samples, reports[1]))
+    {
+        return 1;
+    }
+
+    std::vector<std::string> refs;
+    for (const auto& sample : samples)
+    {
+        refs.push_back(sample.text);
+    }
+    std::ostringstream json;
+    json << "{\"samples\": " << samples.size() << ", \"variants\": [";
+    for (int i = 0; i < 2; i++)
+    {
+        const auto& report = reports[i];
+        json << (i ? ", " : "") << "{\"variant\": \"" << report.variant << "\""
+             << ", \"model_mb\": " << report.model_mb
+             << ", \"load_ms\": " << report.load_ms
+             << ", \"rtf\": " << report.infer_ms / 1000.0 / report.audio_s
+             << ", \"cer\": " << cer(report.hyps, refs)
+             << ", \"cer_vs_float\": " << cer(report.hyps, reports[0].hyps) << "}";
+    }
+    json << "]}";
+
+    LOG_PRINT(json.str());
+    if (!report_path.empty())
+    {
+        std::ofstream(report_path) << json.str() << std::endl;
+        INFO_PRINT("✓ Report saved to: " + report_path);
+    }
+    return 0;
+}